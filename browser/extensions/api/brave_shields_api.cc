@@ -17,6 +17,7 @@
 #include "brave/common/extensions/api/brave_shields.h"
 #include "brave/components/brave_shields/browser/ad_block_custom_filters_service.h"
 #include "brave/components/brave_shields/browser/ad_block_service.h"
+#include "brave/components/brave_shields/browser/ad_block_service_helper.h"
 #include "brave/components/brave_shields/browser/brave_shields_p3a.h"
 #include "brave/components/brave_shields/browser/brave_shields_util.h"
 #include "brave/components/brave_shields/common/brave_shield_constants.h"
@@ -68,15 +69,11 @@ BraveShieldsUrlCosmeticResourcesFunction::Run() {
 std::unique_ptr<base::ListValue>
 BraveShieldsUrlCosmeticResourcesFunction::GetUrlCosmeticResourcesOnTaskRunner(
     const std::string& url) {
-  absl::optional<base::Value> resources =
+  cosmetic_filters::mojom::CosmeticResourcesPtr resources =
       g_brave_browser_process->ad_block_service()->UrlCosmeticResources(url);
 
-  if (!resources || !resources->is_dict()) {
-    return std::unique_ptr<base::ListValue>();
-  }
-
   auto result_list = std::make_unique<base::ListValue>();
-  result_list->Append(std::move(*resources));
+  result_list->Append(brave_shields::CosmeticResourcesToValue(*resources));
   return result_list;
 }
 
@@ -113,16 +110,20 @@ std::unique_ptr<base::ListValue> BraveShieldsHiddenClassIdSelectorsFunction::
         const std::vector<std::string>& classes,
         const std::vector<std::string>& ids,
         const std::vector<std::string>& exceptions) {
-  absl::optional<base::Value> hide_selectors =
+  cosmetic_filters::mojom::CosmeticResourcesPtr resources =
       g_brave_browser_process->ad_block_service()->HiddenClassIdSelectors(
           classes, ids, exceptions);
 
-  if (!hide_selectors || !hide_selectors->is_list())
-    return std::make_unique<base::ListValue>();
-
-  auto result_list =
-      std::make_unique<base::ListValue>(hide_selectors->GetList());
-
+  // The extension expects the hide selectors and the force hide selectors as
+  // two separate lists.
+  auto result_list = std::make_unique<base::ListValue>();
+  for (std::vector<std::string>* selectors :
+       {&resources->hide_selectors, &resources->force_hide_selectors}) {
+    base::Value selectors_list(base::Value::Type::LIST);
+    for (std::string& selector : *selectors)
+      selectors_list.Append(std::move(selector));
+    result_list->Append(std::move(selectors_list));
+  }
   return result_list;
 }
 
@@ -77,8 +77,8 @@ int OnHeadersReceived_AdBlockCspWork(
           new net::HttpResponseHeaders(response_headers->raw_headers());
     }
 
-    scoped_refptr<base::SequencedTaskRunner> task_runner =
-        g_brave_browser_process->ad_block_service()->GetTaskRunner();
+    scoped_refptr<base::TaskRunner> task_runner =
+        g_brave_browser_process->ad_block_service()->GetMatchingTaskRunner();
 
     std::string original_csp_string;
     absl::optional<std::string> original_csp = absl::nullopt;
@@ -5,14 +5,20 @@
 
 #include "brave/browser/net/brave_ad_block_tp_network_delegate_helper.h"
 
+#include <map>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "base/base64url.h"
+#include "base/containers/mru_cache.h"
 #include "base/feature_list.h"
+#include "base/memory/ptr_util.h"
+#include "base/memory/weak_ptr.h"
 #include "base/strings/string_util.h"
+#include "base/supports_user_data.h"
+#include "base/time/time.h"
 #include "brave/browser/brave_browser_process.h"
 #include "brave/browser/brave_shields/brave_shields_web_contents_observer.h"
 #include "brave/browser/net/url_context.h"
@@ -62,27 +68,112 @@ struct EngineFlags {
   bool did_match_important = false;
 };
 
-void UseCnameResult(scoped_refptr<base::SequencedTaskRunner> task_runner,
+void UseCnameResult(scoped_refptr<base::TaskRunner> task_runner,
                     const ResponseCallback& next_callback,
                     std::shared_ptr<BraveRequestInfo> ctx,
                     EngineFlags previous_result,
                     absl::optional<std::string> cname);
 
+using CnameCallback = base::OnceCallback<void(absl::optional<std::string>)>;
+
+// User data key for CnameCache.
+const void* const kCnameCacheUserDataKey = &kCnameCacheUserDataKey;
+
+// The number of canonical names kept per profile.
+constexpr size_t kCnameCacheSize = 1000;
+
+// How long a resolved canonical name is reused. The resolve host API does not
+// report record TTLs, so this stays well below typical CNAME TTLs.
+constexpr base::TimeDelta kCnameCacheTtl = base::TimeDelta::FromMinutes(1);
+
+// Remembers the canonical names resolved for CNAME uncloaking in a profile,
+// and lets requests for a host that is already being resolved share that
+// resolution instead of starting another one.
+class CnameCache : public base::SupportsUserData::Data {
+ public:
+  using Key = std::pair<net::NetworkIsolationKey, std::string>;
+
+  CnameCache() : entries_(kCnameCacheSize) {}
+  ~CnameCache() override = default;
+
+  static CnameCache* FromBrowserContext(
+      content::BrowserContext* browser_context) {
+    DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
+    auto* self = static_cast<CnameCache*>(
+        browser_context->GetUserData(kCnameCacheUserDataKey));
+    if (!self) {
+      self = new CnameCache();
+      browser_context->SetUserData(kCnameCacheUserDataKey,
+                                   base::WrapUnique(self));
+    }
+    return self;
+  }
+
+  // Runs |callback| with the canonical name of |key| right away if it is
+  // cached. Otherwise queues |callback| and returns true if the caller should
+  // start the resolution, which must then be reported to OnResolved().
+  bool Get(const Key& key, CnameCallback callback) {
+    auto it = entries_.Get(key);
+    if (it != entries_.end()) {
+      if (base::TimeTicks::Now() < it->second.expiration_time) {
+        std::move(callback).Run(it->second.cname);
+        return false;
+      }
+      entries_.Erase(it);
+    }
+
+    std::vector<CnameCallback>& callbacks = pending_[key];
+    callbacks.push_back(std::move(callback));
+    return callbacks.size() == 1;
+  }
+
+  void OnResolved(const Key& key, absl::optional<std::string> cname) {
+    DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
+    // Failed resolutions are not cached, so that the next request for the
+    // host retries.
+    if (cname.has_value()) {
+      entries_.Put(key,
+                   Entry{*cname, base::TimeTicks::Now() + kCnameCacheTtl});
+    }
+
+    auto it = pending_.find(key);
+    if (it == pending_.end()) {
+      return;
+    }
+    std::vector<CnameCallback> callbacks = std::move(it->second);
+    pending_.erase(it);
+    for (auto& callback : callbacks) {
+      std::move(callback).Run(cname);
+    }
+  }
+
+  base::WeakPtr<CnameCache> GetWeakPtr() { return weak_factory_.GetWeakPtr(); }
+
+ private:
+  struct Entry {
+    std::string cname;
+    base::TimeTicks expiration_time;
+  };
+
+  base::MRUCache<Key, Entry> entries_;
+  std::map<Key, std::vector<CnameCallback>> pending_;
+
+  base::WeakPtrFactory<CnameCache> weak_factory_{this};
+
+  DISALLOW_COPY_AND_ASSIGN(CnameCache);
+};
+
 class AdblockCnameResolveHostClient : public network::mojom::ResolveHostClient {
  private:
   mojo::Receiver<network::mojom::ResolveHostClient> receiver_{this};
-  base::OnceCallback<void(absl::optional<std::string>)> cb_;
+  CnameCallback cb_;
   base::TimeTicks start_time_;
 
  public:
-  AdblockCnameResolveHostClient(
-      const ResponseCallback& next_callback,
-      scoped_refptr<base::SequencedTaskRunner> task_runner,
-      std::shared_ptr<BraveRequestInfo> ctx,
-      EngineFlags previous_result) {
+  AdblockCnameResolveHostClient(std::shared_ptr<BraveRequestInfo> ctx,
+                                CnameCallback cb) {
     DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
-    cb_ = base::BindOnce(&UseCnameResult, task_runner, std::move(next_callback),
-                         ctx, previous_result);
+    cb_ = std::move(cb);
 
     const auto network_isolation_key = ctx->network_isolation_key;
 
@@ -199,9 +290,30 @@ EngineFlags ShouldBlockRequestOnTaskRunner(
   return previous_result;
 }
 
+void ResolveCname(scoped_refptr<base::TaskRunner> task_runner,
+                  const ResponseCallback& next_callback,
+                  std::shared_ptr<BraveRequestInfo> ctx,
+                  EngineFlags previous_result) {
+  DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
+  DCHECK(ctx->browser_context);
+
+  CnameCallback callback = base::BindOnce(&UseCnameResult, task_runner,
+                                          next_callback, ctx, previous_result);
+  CnameCache* cache = CnameCache::FromBrowserContext(ctx->browser_context);
+  const CnameCache::Key key(ctx->network_isolation_key,
+                            ctx->request_url.host());
+  if (!cache->Get(key, std::move(callback))) {
+    return;
+  }
+
+  // This will be deleted by `AdblockCnameResolveHostClient::OnComplete`.
+  new AdblockCnameResolveHostClient(
+      ctx, base::BindOnce(&CnameCache::OnResolved, cache->GetWeakPtr(), key));
+}
+
 void OnShouldBlockRequestResult(
     bool then_check_uncloaked,
-    scoped_refptr<base::SequencedTaskRunner> task_runner,
+    scoped_refptr<base::TaskRunner> task_runner,
     const ResponseCallback& next_callback,
     std::shared_ptr<BraveRequestInfo> ctx,
     EngineFlags result) {
@@ -210,15 +322,13 @@ void OnShouldBlockRequestResult(
     brave_shields::BraveShieldsWebContentsObserver::DispatchBlockedEvent(
         ctx->request_url, ctx->frame_tree_node_id, brave_shields::kAds);
   } else if (then_check_uncloaked) {
-    // This will be deleted by `AdblockCnameResolveHostClient::OnComplete`.
-    new AdblockCnameResolveHostClient(std::move(next_callback), task_runner,
-                                      ctx, result);
+    ResolveCname(task_runner, next_callback, ctx, result);
     return;
   }
   next_callback.Run();
 }
 
-void UseCnameResult(scoped_refptr<base::SequencedTaskRunner> task_runner,
+void UseCnameResult(scoped_refptr<base::TaskRunner> task_runner,
                     const ResponseCallback& next_callback,
                     std::shared_ptr<BraveRequestInfo> ctx,
                     EngineFlags previous_result,
@@ -285,8 +395,8 @@ void OnBeforeURLRequestAdBlockTP(const ResponseCallback& next_callback,
   DCHECK(!ctx->request_url.is_empty());
   DCHECK(!ctx->initiator_url.is_empty());
 
-  scoped_refptr<base::SequencedTaskRunner> task_runner =
-      g_brave_browser_process->ad_block_service()->GetTaskRunner();
+  scoped_refptr<base::TaskRunner> task_runner =
+      g_brave_browser_process->ad_block_service()->GetMatchingTaskRunner();
 
   // DoH or standard DNS queries won't be routed through Tor, so we need to
   // skip it.
@@ -318,30 +428,34 @@ void OnBeforeURLRequestAdBlockTP(const ResponseCallback& next_callback,
                      task_runner, next_callback, ctx));
 }
 
-int OnBeforeURLRequest_AdBlockTPPreWork(const ResponseCallback& next_callback,
-                                        std::shared_ptr<BraveRequestInfo> ctx) {
+bool ShouldRunAdBlockTPPreWork(const BraveRequestInfo& ctx) {
   // If the following info isn't available, then proper content settings can't
   // be looked up, so do nothing.
-  if (ctx->request_url.is_empty() ||
-      ctx->request_url.SchemeIs(content::kChromeDevToolsScheme) ||
-      ctx->initiator_url.is_empty() || !ctx->initiator_url.has_host() ||
-      !ctx->allow_brave_shields || ctx->allow_ads ||
-      ctx->resource_type == BraveRequestInfo::kInvalidResourceType) {
-    return net::OK;
+  if (ctx.request_url.is_empty() ||
+      ctx.request_url.SchemeIs(content::kChromeDevToolsScheme) ||
+      ctx.initiator_url.is_empty() || !ctx.initiator_url.has_host() ||
+      !ctx.allow_brave_shields || ctx.allow_ads ||
+      ctx.resource_type == BraveRequestInfo::kInvalidResourceType) {
+    return false;
   }
 
   // Also, until a better solution is available, we explicitly allow any
   // request from an extension.
-  if (ctx->initiator_url.SchemeIs(kChromeExtensionScheme) &&
+  if (ctx.initiator_url.SchemeIs(kChromeExtensionScheme) &&
       !base::FeatureList::IsEnabled(
           ::brave_shields::features::kBraveExtensionNetworkBlocking)) {
-    return net::OK;
+    return false;
   }
 
   // Requests for main frames are handled by DomainBlockNavigationThrottle,
   // which can display a custom interstitial with an option to proceed if a
   // block is made. We don't need to check these twice.
-  if (ctx->resource_type == blink::mojom::ResourceType::kMainFrame) {
+  return ctx.resource_type != blink::mojom::ResourceType::kMainFrame;
+}
+
+int OnBeforeURLRequest_AdBlockTPPreWork(const ResponseCallback& next_callback,
+                                        std::shared_ptr<BraveRequestInfo> ctx) {
+  if (!ShouldRunAdBlockTPPreWork(*ctx)) {
     return net::OK;
   }
 
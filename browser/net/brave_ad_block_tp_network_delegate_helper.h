@@ -16,6 +16,9 @@ class HostResolver;
 
 namespace brave {
 
+// Whether |ctx| may be blocked by OnBeforeURLRequest_AdBlockTPPreWork.
+bool ShouldRunAdBlockTPPreWork(const BraveRequestInfo& ctx);
+
 int OnBeforeURLRequest_AdBlockTPPreWork(
     const ResponseCallback& next_callback,
     std::shared_ptr<BraveRequestInfo> ctx);
@@ -46,18 +46,18 @@ void OnBeforeURLRequest_HttpsePostFileWork(
   next_callback.Run();
 }
 
+bool ShouldRunHttpsePreFileWork(const BraveRequestInfo& ctx) {
+  // Don't try to overwrite an already set URL by another delegate (adblock/tp)
+  return ctx.new_url_spec.empty() && !ctx.tab_origin.is_empty() &&
+         !ctx.allow_http_upgradable_resource && ctx.allow_brave_shields;
+}
+
 int OnBeforeURLRequest_HttpsePreFileWork(
     const ResponseCallback& next_callback,
     std::shared_ptr<BraveRequestInfo> ctx) {
   DCHECK_CURRENTLY_ON(BrowserThread::UI);
 
-  // Don't try to overwrite an already set URL by another delegate (adblock/tp)
-  if (!ctx->new_url_spec.empty()) {
-    return net::OK;
-  }
-
-  if (ctx->tab_origin.is_empty() || ctx->allow_http_upgradable_resource ||
-      !ctx->allow_brave_shields) {
+  if (!ShouldRunHttpsePreFileWork(*ctx)) {
     return net::OK;
   }
 
@@ -9,6 +9,9 @@
 
 namespace brave {
 
+// Whether OnBeforeURLRequest_HttpsePreFileWork may upgrade |ctx|.
+bool ShouldRunHttpsePreFileWork(const BraveRequestInfo& ctx);
+
 int OnBeforeURLRequest_HttpsePreFileWork(
     const ResponseCallback& next_callback,
     std::shared_ptr<BraveRequestInfo> ctx);
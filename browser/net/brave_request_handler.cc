@@ -10,6 +10,7 @@
 
 #include "base/containers/contains.h"
 #include "base/feature_list.h"
+#include "base/metrics/histogram_macros.h"
 #include "base/task/post_task.h"
 #include "brave/browser/net/brave_ad_block_csp_network_delegate_helper.h"
 #include "brave/browser/net/brave_ad_block_tp_network_delegate_helper.h"
@@ -62,6 +63,27 @@ static bool IsInternalScheme(std::shared_ptr<brave::BraveRequestInfo> ctx) {
          ctx->request_url.SchemeIs(content::kChromeUIScheme);
 }
 
+static void RecordCallbacksTime(brave::BraveNetworkDelegateEventType event_type,
+                                base::TimeTicks start_time) {
+  const base::TimeDelta elapsed = base::TimeTicks::Now() - start_time;
+  switch (event_type) {
+    case brave::kOnBeforeRequest:
+      UMA_HISTOGRAM_TIMES("Brave.RequestHandler.OnBeforeURLRequestTime",
+                          elapsed);
+      break;
+    case brave::kOnBeforeStartTransaction:
+      UMA_HISTOGRAM_TIMES("Brave.RequestHandler.OnBeforeStartTransactionTime",
+                          elapsed);
+      break;
+    case brave::kOnHeadersReceived:
+      UMA_HISTOGRAM_TIMES("Brave.RequestHandler.OnHeadersReceivedTime",
+                          elapsed);
+      break;
+    default:
+      break;
+  }
+}
+
 BraveRequestHandler::BraveRequestHandler() {
   DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
   SetupCallbacks();
@@ -70,39 +92,42 @@ BraveRequestHandler::BraveRequestHandler() {
 BraveRequestHandler::~BraveRequestHandler() = default;
 
 void BraveRequestHandler::SetupCallbacks() {
-  brave::OnBeforeURLRequestCallback callback =
-      base::BindRepeating(brave::OnBeforeURLRequest_SiteHacksWork);
-  before_url_request_callbacks_.push_back(callback);
+  AddBeforeURLRequestCallback(
+      base::BindRepeating(brave::OnBeforeURLRequest_SiteHacksWork));
 
-  callback = base::BindRepeating(brave::OnBeforeURLRequest_AdBlockTPPreWork);
-  before_url_request_callbacks_.push_back(callback);
+  AddBeforeURLRequestCallback(
+      base::BindRepeating(brave::OnBeforeURLRequest_AdBlockTPPreWork),
+      base::BindRepeating(brave::ShouldRunAdBlockTPPreWork));
 
-  callback = base::BindRepeating(brave::OnBeforeURLRequest_HttpsePreFileWork);
-  before_url_request_callbacks_.push_back(callback);
+  AddBeforeURLRequestCallback(
+      base::BindRepeating(brave::OnBeforeURLRequest_HttpsePreFileWork),
+      base::BindRepeating(brave::ShouldRunHttpsePreFileWork));
 
-  callback =
-      base::BindRepeating(brave::OnBeforeURLRequest_CommonStaticRedirectWork);
-  before_url_request_callbacks_.push_back(callback);
+  AddBeforeURLRequestCallback(
+      base::BindRepeating(brave::OnBeforeURLRequest_CommonStaticRedirectWork));
 
 #if BUILDFLAG(DECENTRALIZED_DNS_ENABLED) && BUILDFLAG(BRAVE_WALLET_ENABLED)
-  callback = base::BindRepeating(
+  auto decentralized_dns_callback = base::BindRepeating(
       decentralized_dns::OnBeforeURLRequest_DecentralizedDnsPreRedirectWork);
-  before_url_request_callbacks_.push_back(callback);
+  AddBeforeURLRequestCallback(
+      std::move(decentralized_dns_callback),
+      base::BindRepeating(
+          decentralized_dns::ShouldRunDecentralizedDnsPreRedirectWork));
 #endif
 
-  callback = base::BindRepeating(brave_rewards::OnBeforeURLRequest);
-  before_url_request_callbacks_.push_back(callback);
+  AddBeforeURLRequestCallback(
+      base::BindRepeating(brave_rewards::OnBeforeURLRequest));
 
 #if BUILDFLAG(ENABLE_BRAVE_TRANSLATE_GO)
-  callback =
-      base::BindRepeating(brave::OnBeforeURLRequest_TranslateRedirectWork);
-  before_url_request_callbacks_.push_back(callback);
+  AddBeforeURLRequestCallback(
+      base::BindRepeating(brave::OnBeforeURLRequest_TranslateRedirectWork));
 #endif
 
 #if BUILDFLAG(ENABLE_IPFS)
   if (base::FeatureList::IsEnabled(ipfs::features::kIpfsFeature)) {
-    callback = base::BindRepeating(ipfs::OnBeforeURLRequest_IPFSRedirectWork);
-    before_url_request_callbacks_.push_back(callback);
+    AddBeforeURLRequestCallback(
+        base::BindRepeating(ipfs::OnBeforeURLRequest_IPFSRedirectWork),
+        base::BindRepeating(ipfs::ShouldRunIPFSRedirectWork));
     brave::OnHeadersReceivedCallback ipfs_headers_received_callback =
         base::BindRepeating(ipfs::OnHeadersReceived_IPFSRedirectWork);
     headers_received_callbacks_.push_back(ipfs_headers_received_callback);
@@ -141,6 +166,13 @@ void BraveRequestHandler::SetupCallbacks() {
   }
 }
 
+void BraveRequestHandler::AddBeforeURLRequestCallback(
+    brave::OnBeforeURLRequestCallback callback,
+    brave::RequestPrecondition precondition) {
+  before_url_request_callbacks_.push_back(std::move(callback));
+  before_url_request_preconditions_.push_back(std::move(precondition));
+}
+
 bool BraveRequestHandler::IsRequestIdentifierValid(
     uint64_t request_identifier) {
   return base::Contains(callbacks_, request_identifier);
@@ -156,8 +188,7 @@ int BraveRequestHandler::OnBeforeURLRequest(
   ctx->new_url = new_url;
   ctx->event_type = brave::kOnBeforeRequest;
   callbacks_[ctx->request_identifier] = std::move(callback);
-  RunNextCallback(ctx);
-  return net::ERR_IO_PENDING;
+  return StartCallbacks(ctx);
 }
 
 int BraveRequestHandler::OnBeforeStartTransaction(
@@ -170,8 +201,7 @@ int BraveRequestHandler::OnBeforeStartTransaction(
   ctx->event_type = brave::kOnBeforeStartTransaction;
   ctx->headers = headers;
   callbacks_[ctx->request_identifier] = std::move(callback);
-  RunNextCallback(ctx);
-  return net::ERR_IO_PENDING;
+  return StartCallbacks(ctx);
 }
 
 int BraveRequestHandler::OnHeadersReceived(
@@ -198,8 +228,7 @@ int BraveRequestHandler::OnHeadersReceived(
   ctx->override_response_headers = override_response_headers;
   ctx->allowed_unsafe_redirect_url = allowed_unsafe_redirect_url;
 
-  RunNextCallback(ctx);
-  return net::ERR_IO_PENDING;
+  return StartCallbacks(ctx);
 }
 
 void BraveRequestHandler::OnURLRequestDestroyed(
@@ -220,8 +249,28 @@ void BraveRequestHandler::RunCallbackForRequestIdentifier(
                  base::BindOnce(std::move(it->second), rv));
 }
 
-// TODO(iefremov): Merge all callback containers into one and run only one loop
-// instead of many (issues/5574).
+int BraveRequestHandler::StartCallbacks(
+    std::shared_ptr<brave::BraveRequestInfo> ctx) {
+  DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
+
+  ctx->start_time = base::TimeTicks::Now();
+  const int rv = RunCallbacks(ctx);
+  if (rv == net::ERR_IO_PENDING) {
+    return rv;
+  }
+
+  // Nothing had to wait, so complete the request synchronously instead of
+  // bouncing the result through the UI task queue. The callers only expect
+  // these two results synchronously.
+  if (rv == net::OK || rv == net::ERR_BLOCKED_BY_CLIENT) {
+    callbacks_.erase(ctx->request_identifier);
+    return rv;
+  }
+
+  RunCallbackForRequestIdentifier(ctx->request_identifier, rv);
+  return net::ERR_IO_PENDING;
+}
+
 void BraveRequestHandler::RunNextCallback(
     std::shared_ptr<brave::BraveRequestInfo> ctx) {
   DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
@@ -230,20 +279,40 @@ void BraveRequestHandler::RunNextCallback(
     return;
   }
 
+  const int rv = RunCallbacks(ctx);
+  if (rv == net::ERR_IO_PENDING) {
+    return;
+  }
+
+  RunCallbackForRequestIdentifier(ctx->request_identifier, rv);
+}
+
+// TODO(iefremov): Merge all callback containers into one and run only one loop
+// instead of many (issues/5574).
+int BraveRequestHandler::RunCallbacks(
+    std::shared_ptr<brave::BraveRequestInfo> ctx) {
   // Continue processing callbacks until we hit one that returns PENDING
   int rv = net::OK;
 
   if (ctx->event_type == brave::kOnBeforeRequest) {
     while (before_url_request_callbacks_.size() !=
            ctx->next_url_request_index) {
+      const size_t index = ctx->next_url_request_index++;
+      // Checked when the callback is reached, so that it sees the results of
+      // the callbacks before it.
+      const brave::RequestPrecondition& precondition =
+          before_url_request_preconditions_[index];
+      if (precondition && !precondition.Run(*ctx)) {
+        continue;
+      }
       brave::OnBeforeURLRequestCallback callback =
-          before_url_request_callbacks_[ctx->next_url_request_index++];
+          before_url_request_callbacks_[index];
       brave::ResponseCallback next_callback =
           base::BindRepeating(&BraveRequestHandler::RunNextCallback,
                               weak_factory_.GetWeakPtr(), ctx);
       rv = callback.Run(next_callback, ctx);
       if (rv == net::ERR_IO_PENDING) {
-        return;
+        return rv;
       }
       if (rv != net::OK) {
         break;
@@ -259,7 +328,7 @@ void BraveRequestHandler::RunNextCallback(
                               weak_factory_.GetWeakPtr(), ctx);
       rv = callback.Run(ctx->headers, next_callback, ctx);
       if (rv == net::ERR_IO_PENDING) {
-        return;
+        return rv;
       }
       if (rv != net::OK) {
         break;
@@ -276,7 +345,7 @@ void BraveRequestHandler::RunNextCallback(
                         ctx->override_response_headers,
                         ctx->allowed_unsafe_redirect_url, next_callback, ctx);
       if (rv == net::ERR_IO_PENDING) {
-        return;
+        return rv;
       }
       if (rv != net::OK) {
         break;
@@ -284,9 +353,10 @@ void BraveRequestHandler::RunNextCallback(
     }
   }
 
+  RecordCallbacksTime(ctx->event_type, ctx->start_time);
+
   if (rv != net::OK) {
-    RunCallbackForRequestIdentifier(ctx->request_identifier, rv);
-    return;
+    return rv;
   }
 
   if (ctx->event_type == brave::kOnBeforeRequest) {
@@ -298,11 +368,9 @@ void BraveRequestHandler::RunNextCallback(
     if (ctx->blocked_by == brave::kAdBlocked ||
         ctx->blocked_by == brave::kOtherBlocked) {
       if (!ctx->ShouldMockRequest()) {
-        RunCallbackForRequestIdentifier(ctx->request_identifier,
-                                        net::ERR_BLOCKED_BY_CLIENT);
-        return;
+        return net::ERR_BLOCKED_BY_CLIENT;
       }
     }
   }
-  RunCallbackForRequestIdentifier(ctx->request_identifier, rv);
+  return rv;
 }
@@ -45,9 +45,25 @@ class BraveRequestHandler {
 
  private:
   void SetupCallbacks();
+  // Adds |callback| to the OnBeforeURLRequest callbacks. It is skipped for
+  // requests that fail |precondition|, if one is given.
+  void AddBeforeURLRequestCallback(
+      brave::OnBeforeURLRequestCallback callback,
+      brave::RequestPrecondition precondition = brave::RequestPrecondition());
+  // Starts running the callbacks for |ctx|. Returns the result right away if
+  // no callback needs to wait, otherwise returns net::ERR_IO_PENDING and the
+  // callback for the request is run once they are done.
+  int StartCallbacks(std::shared_ptr<brave::BraveRequestInfo> ctx);
   void RunNextCallback(std::shared_ptr<brave::BraveRequestInfo> ctx);
+  // Runs the remaining callbacks for |ctx| until one of them returns
+  // net::ERR_IO_PENDING, which is then returned. Otherwise returns the result
+  // of the event.
+  int RunCallbacks(std::shared_ptr<brave::BraveRequestInfo> ctx);
 
   std::vector<brave::OnBeforeURLRequestCallback> before_url_request_callbacks_;
+  // Indexed like |before_url_request_callbacks_|, null when a callback always
+  // runs.
+  std::vector<brave::RequestPrecondition> before_url_request_preconditions_;
   std::vector<brave::OnBeforeStartTransactionCallback>
       before_start_transaction_callbacks_;
   std::vector<brave::OnHeadersReceivedCallback> headers_received_callbacks_;
@@ -30,11 +30,24 @@ std::string GetValue(const std::vector<std::string>& arr, RecordKeys key) {
 
 }  // namespace
 
+bool ShouldRunDecentralizedDnsPreRedirectWork(
+    const brave::BraveRequestInfo& ctx) {
+  if (!ctx.browser_context || !IsDecentralizedDnsEnabled() ||
+      ctx.browser_context->IsOffTheRecord() || !g_browser_process) {
+    return false;
+  }
+
+  return (IsUnstoppableDomainsTLD(ctx.request_url) &&
+          IsUnstoppableDomainsResolveMethodEthereum(
+              g_browser_process->local_state())) ||
+         (IsENSTLD(ctx.request_url) &&
+          IsENSResolveMethodEthereum(g_browser_process->local_state()));
+}
+
 int OnBeforeURLRequest_DecentralizedDnsPreRedirectWork(
     const brave::ResponseCallback& next_callback,
     std::shared_ptr<brave::BraveRequestInfo> ctx) {
-  if (!ctx->browser_context || !IsDecentralizedDnsEnabled() ||
-      ctx->browser_context->IsOffTheRecord() || !g_browser_process) {
+  if (!ShouldRunDecentralizedDnsPreRedirectWork(*ctx)) {
     return net::OK;
   }
 
@@ -14,6 +14,11 @@
 
 namespace decentralized_dns {
 
+// Whether |ctx| is for a decentralized DNS domain that is resolved through
+// Ethereum, without binding an RPC controller.
+bool ShouldRunDecentralizedDnsPreRedirectWork(
+    const brave::BraveRequestInfo& ctx);
+
 // Issue eth_call requests via Ethereum provider such as Infura to query
 // decentralized DNS records, and redirect URL requests based on them.
 int OnBeforeURLRequest_DecentralizedDnsPreRedirectWork(
@@ -110,6 +110,33 @@ TEST_F(DecentralizedDnsNetworkDelegateHelperTest,
   EXPECT_TRUE(brave_request_info->new_url_spec.empty());
 }
 
+TEST_F(DecentralizedDnsNetworkDelegateHelperTest,
+       ShouldRunDecentralizedDnsPreRedirectWork) {
+  brave::BraveRequestInfo brave_request_info(GURL("http://brave.crypto"));
+  brave_request_info.browser_context = profile();
+
+  // Resolve method is not set to Ethereum.
+  EXPECT_FALSE(ShouldRunDecentralizedDnsPreRedirectWork(brave_request_info));
+
+  local_state()->SetInteger(kUnstoppableDomainsResolveMethod,
+                            static_cast<int>(ResolveMethodTypes::ETHEREUM));
+  EXPECT_TRUE(ShouldRunDecentralizedDnsPreRedirectWork(brave_request_info));
+
+  // TLD is not a decentralized DNS one.
+  brave_request_info.request_url = GURL("http://test.com");
+  EXPECT_FALSE(ShouldRunDecentralizedDnsPreRedirectWork(brave_request_info));
+
+  // ENS resolve method is not set to Ethereum.
+  brave_request_info.request_url = GURL("http://brave.eth");
+  EXPECT_FALSE(ShouldRunDecentralizedDnsPreRedirectWork(brave_request_info));
+
+  // OTR context.
+  brave_request_info.request_url = GURL("http://brave.crypto");
+  brave_request_info.browser_context =
+      profile()->GetPrimaryOTRProfile(/*create_if_needed=*/true);
+  EXPECT_FALSE(ShouldRunDecentralizedDnsPreRedirectWork(brave_request_info));
+}
+
 TEST_F(DecentralizedDnsNetworkDelegateHelperTest,
        DecentralizedDnsRedirectWork) {
   GURL url("http://brave.crypto");
@@ -8,6 +8,7 @@
 #include <string>
 
 #include "brave/browser/profiles/profile_util.h"
+#include "brave/components/ipfs/ipfs_constants.h"
 #include "brave/components/ipfs/ipfs_utils.h"
 #include "chrome/common/channel_info.h"
 #include "components/prefs/pref_service.h"
@@ -17,10 +18,16 @@
 
 namespace ipfs {
 
+bool ShouldRunIPFSRedirectWork(const brave::BraveRequestInfo& ctx) {
+  return ctx.browser_context && brave::IsRegularProfile(ctx.browser_context) &&
+         (ctx.request_url.SchemeIs(kIPFSScheme) ||
+          ctx.request_url.SchemeIs(kIPNSScheme));
+}
+
 int OnBeforeURLRequest_IPFSRedirectWork(
     const brave::ResponseCallback& next_callback,
     std::shared_ptr<brave::BraveRequestInfo> ctx) {
-  if (!ctx->browser_context || !brave::IsRegularProfile(ctx->browser_context))
+  if (!ShouldRunIPFSRedirectWork(*ctx))
     return net::OK;
   auto* prefs = user_prefs::UserPrefs::Get(ctx->browser_context);
   if (IsIpfsResolveMethodDisabled(prefs)) {
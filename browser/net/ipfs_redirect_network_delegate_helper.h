@@ -14,6 +14,10 @@
 
 namespace ipfs {
 
+// Whether |ctx| is for an ipfs:// or ipns:// URL that
+// OnBeforeURLRequest_IPFSRedirectWork may translate.
+bool ShouldRunIPFSRedirectWork(const brave::BraveRequestInfo& ctx);
+
 int OnBeforeURLRequest_IPFSRedirectWork(
     const brave::ResponseCallback& next_callback,
     std::shared_ptr<brave::BraveRequestInfo> ctx);
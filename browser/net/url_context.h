@@ -10,6 +10,7 @@
 #include <set>
 #include <string>
 
+#include "base/time/time.h"
 #include "net/base/network_isolation_key.h"
 #include "net/http/http_request_headers.h"
 #include "net/http/http_response_headers.h"
@@ -130,10 +131,17 @@ struct BraveRequestInfo {
   friend class ::BraveRequestHandler;
 
   GURL* new_url = nullptr;
+  // When the handler started running callbacks for the current event.
+  base::TimeTicks start_time;
 
   DISALLOW_COPY_AND_ASSIGN(BraveRequestInfo);
 };
 
+// Returns false if a callback has nothing to do for the request, so that the
+// handler can skip it. Must not modify the request.
+using RequestPrecondition =
+    base::RepeatingCallback<bool(const BraveRequestInfo& ctx)>;
+
 // ResponseListener
 using OnBeforeURLRequestCallback =
     base::RepeatingCallback<int(const ResponseCallback& next_callback,
@@ -23,6 +23,54 @@ typedef struct C_Engine C_Engine;
  */
 typedef void (*C_DomainResolverCallback)(const char*, uint32_t*, uint32_t*);
 
+/**
+ * The part of a url-specific cosmetic resources result that is handed to a
+ * `C_CosmeticResourceVisitor`.
+ */
+enum C_CosmeticResourceKind {
+  /**
+   * A hide selector, in `key`.
+   */
+  C_CosmeticResourceKind_HideSelector = 0,
+  /**
+   * A style selector in `key` with one of its declarations in `value`.
+   */
+  C_CosmeticResourceKind_StyleSelector = 1,
+  /**
+   * An exception, in `key`.
+   */
+  C_CosmeticResourceKind_Exception = 2,
+  /**
+   * The injected scriptlet code, in `key`.
+   */
+  C_CosmeticResourceKind_InjectedScript = 3,
+  /**
+   * The page has `generichide` set.
+   */
+  C_CosmeticResourceKind_GenericHide = 4,
+};
+typedef uint8_t C_CosmeticResourceKind;
+
+/**
+ * Receives one entry of a url-specific cosmetic resources result, of the given
+ * `kind`. Strings are borrowed for the duration of the call only and are not
+ * NUL-terminated.
+ */
+typedef void (*C_CosmeticResourceVisitor)(void* context,
+                                          C_CosmeticResourceKind kind,
+                                          const char* key,
+                                          size_t key_len,
+                                          const char* value,
+                                          size_t value_len);
+
+/**
+ * Receives one selector of a result. The string is borrowed for the duration
+ * of the call only and is not NUL-terminated.
+ */
+typedef void (*C_SelectorVisitor)(void* context,
+                                  const char* selector,
+                                  size_t selector_len);
+
 /**
  * Passes a callback to the adblock library, allowing it to be used for domain
  * resolution.
@@ -39,6 +87,20 @@ bool set_domain_resolver(C_DomainResolverCallback resolver);
 struct C_Engine* engine_create(const char* rules);
 struct C_Engine* engine_create_from_buffer(const char* data, size_t data_size);
 
+/**
+ * Create a new `Engine` from several filter lists at once.
+ *
+ * Lists are compiled into a single engine, so a request only needs to be
+ * checked once rather than once per list. `include_network` and
+ * `include_cosmetic` select which kinds of rules are kept, which allows
+ * splitting network matching from cosmetic filtering.
+ */
+struct C_Engine* engine_create_from_buffers(const char* const* data,
+                                            const size_t* data_sizes,
+                                            size_t count,
+                                            bool include_network,
+                                            bool include_cosmetic);
+
 /**
  * Checks if a `url` matches for the specified `Engine` within the context.
  *
@@ -58,6 +120,25 @@ void engine_match(struct C_Engine* engine,
                   bool* did_match_important,
                   char** redirect);
 
+/**
+ * Same as `engine_match`, but borrows its string inputs as (pointer, length)
+ * pairs which do not need to be NUL-terminated, and takes the request type as
+ * a code rather than a string. Nothing is copied on the caller's side.
+ */
+void engine_match_slices(struct C_Engine* engine,
+                         const char* url,
+                         size_t url_len,
+                         const char* host,
+                         size_t host_len,
+                         const char* tab_host,
+                         size_t tab_host_len,
+                         bool third_party,
+                         uint8_t resource_type,
+                         bool* did_match_rule,
+                         bool* did_match_exception,
+                         bool* did_match_important,
+                         char** redirect);
+
 /**
  * Returns any CSP directives that should be added to a subdocument or document
  * request's response headers.
@@ -69,6 +150,20 @@ char* engine_get_csp_directives(struct C_Engine* engine,
                                 bool third_party,
                                 const char* resource_type);
 
+/**
+ * Same as `engine_get_csp_directives`, but with borrowed (pointer, length)
+ * string inputs and a request type code.
+ */
+char* engine_get_csp_directives_slices(struct C_Engine* engine,
+                                       const char* url,
+                                       size_t url_len,
+                                       const char* host,
+                                       size_t host_len,
+                                       const char* tab_host,
+                                       size_t tab_host_len,
+                                       bool third_party,
+                                       uint8_t resource_type);
+
 /**
  * Adds a tag to the engine for consideration
  */
@@ -97,6 +192,15 @@ void engine_add_resources(struct C_Engine* engine, const char* resources);
  */
 void engine_remove_tag(struct C_Engine* engine, const char* tag);
 
+/**
+ * Creates an independent copy of `engine` by round-tripping it through its
+ * serialized form, so that the copy can be modified while other threads keep
+ * matching against the original. Enabled tags and resources are not
+ * guaranteed to carry over and should be added to the copy again. Returns
+ * null if the engine could not be copied.
+ */
+struct C_Engine* engine_clone(struct C_Engine* engine);
+
 /**
  * Deserializes a previously serialized data file list.
  */
@@ -120,6 +224,16 @@ void c_char_buffer_destroy(char* s);
  */
 char* engine_url_cosmetic_resources(struct C_Engine* engine, const char* url);
 
+/**
+ * Same as `engine_url_cosmetic_resources`, but hands each part of the result
+ * to `visitor` instead of serializing it to JSON.
+ */
+void engine_url_cosmetic_resources_visit(struct C_Engine* engine,
+                                         const char* url,
+                                         size_t url_len,
+                                         C_CosmeticResourceVisitor visitor,
+                                         void* context);
+
 /**
  * Returns a stylesheet containing all generic cosmetic rules that begin with
  * any of the provided class and id selectors
@@ -134,4 +248,18 @@ char* engine_hidden_class_id_selectors(struct C_Engine* engine,
                                        const char* const* exceptions,
                                        size_t exceptions_size);
 
+/**
+ * Same as `engine_hidden_class_id_selectors`, but hands each selector to
+ * `visitor` instead of serializing them to JSON.
+ */
+void engine_hidden_class_id_selectors_visit(struct C_Engine* engine,
+                                            const char* const* classes,
+                                            size_t classes_size,
+                                            const char* const* ids,
+                                            size_t ids_size,
+                                            const char* const* exceptions,
+                                            size_t exceptions_size,
+                                            C_SelectorVisitor visitor,
+                                            void* context);
+
 #endif /* BRAVE_COMPONENTS_ADBLOCK_RUST_FFI_SRC_LIB_H_ */
@@ -4,7 +4,7 @@ use core::ptr;
 use libc::size_t;
 use std::ffi::CStr;
 use std::ffi::CString;
-use std::os::raw::c_char;
+use std::os::raw::{c_char, c_void};
 use std::string::String;
 
 /// An external callback that receives a hostname and two out-parameters for start and end
@@ -61,6 +61,49 @@ pub unsafe extern "C" fn engine_create(rules: *const c_char) -> *mut Engine {
     engine_create_from_str(rules)
 }
 
+/// Create a new `Engine` from several filter lists at once.
+///
+/// Lists are compiled into a single engine, so a request only needs to be checked once rather than
+/// once per list. `include_network` and `include_cosmetic` select which kinds of rules are kept,
+/// which allows splitting network matching from cosmetic filtering.
+#[no_mangle]
+pub unsafe extern "C" fn engine_create_from_buffers(
+    data: *const *const c_char,
+    data_sizes: *const size_t,
+    count: size_t,
+    include_network: bool,
+    include_cosmetic: bool,
+) -> *mut Engine {
+    let data = std::slice::from_raw_parts(data, count);
+    let data_sizes = std::slice::from_raw_parts(data_sizes, count);
+    let mut filter_set = adblock::lists::FilterSet::new(false);
+    for index in 0..count {
+        let list: &[u8] = std::slice::from_raw_parts(data[index] as *const u8, data_sizes[index]);
+        let rules = std::str::from_utf8(list).unwrap_or_else(|_| {
+            eprintln!("Failed to parse filter list with invalid UTF-8 content");
+            ""
+        });
+        if include_network && include_cosmetic {
+            filter_set.add_filter_list(&rules, adblock::lists::FilterFormat::Standard);
+            continue;
+        }
+        let kept: Vec<String> = rules
+            .lines()
+            .filter(|line| {
+                match adblock::lists::parse_filter(line, false, adblock::lists::FilterFormat::Standard) {
+                    Ok(adblock::lists::ParsedFilter::Network(_)) => include_network,
+                    Ok(adblock::lists::ParsedFilter::Cosmetic(_)) => include_cosmetic,
+                    Err(_) => false,
+                }
+            })
+            .map(|line| line.to_owned())
+            .collect();
+        filter_set.add_filters(&kept, adblock::lists::FilterFormat::Standard);
+    }
+    let engine = Engine::from_filter_set(filter_set, true);
+    Box::into_raw(Box::new(engine))
+}
+
 fn engine_create_from_str(rules: &str) -> *mut Engine {
     let mut filter_set = adblock::lists::FilterSet::new(false);
     filter_set.add_filter_list(&rules, adblock::lists::FilterFormat::Standard);
@@ -68,30 +111,49 @@ fn engine_create_from_str(rules: &str) -> *mut Engine {
     Box::into_raw(Box::new(engine))
 }
 
-/// Checks if a `url` matches for the specified `Engine` within the context.
-///
-/// This API is designed for multi-engine use, so block results are used both as inputs and
-/// outputs. They will be updated to reflect additional checking within this engine, rather than
-/// being replaced with results just for this engine.
-#[no_mangle]
-pub unsafe extern "C" fn engine_match(
+/// Converts a borrowed (pointer, length) pair into a string slice without copying it.
+unsafe fn str_from_raw_parts<'a>(data: *const c_char, len: size_t) -> &'a str {
+    if data.is_null() || len == 0 {
+        return "";
+    }
+    std::str::from_utf8(std::slice::from_raw_parts(data as *const u8, len)).unwrap_or("")
+}
+
+/// Maps the request type codes used by the slice APIs to the names understood by adblock-rust.
+/// Must be kept in sync with `adblock::ResourceType` in wrapper.h.
+fn resource_type_from_code(code: u8) -> &'static str {
+    match code {
+        1 => "main_frame",
+        2 => "sub_frame",
+        3 => "stylesheet",
+        4 => "script",
+        5 => "image",
+        6 => "font",
+        7 => "other",
+        8 => "object",
+        9 => "media",
+        10 => "xhr",
+        11 => "ping",
+        _ => "",
+    }
+}
+
+// Matching only takes a shared borrow of the engine, so that several threads can match against the
+// same engine concurrently. Tags and resources must not be changed while matching is in progress.
+unsafe fn engine_match_str(
     engine: *mut Engine,
-    url: *const c_char,
-    host: *const c_char,
-    tab_host: *const c_char,
+    url: &str,
+    host: &str,
+    tab_host: &str,
     third_party: bool,
-    resource_type: *const c_char,
+    resource_type: &str,
     did_match_rule: *mut bool,
     did_match_exception: *mut bool,
     did_match_important: *mut bool,
     redirect: *mut *mut c_char,
 ) {
-    let url = CStr::from_ptr(url).to_str().unwrap();
-    let host = CStr::from_ptr(host).to_str().unwrap();
-    let tab_host = CStr::from_ptr(tab_host).to_str().unwrap();
-    let resource_type = CStr::from_ptr(resource_type).to_str().unwrap();
     assert!(!engine.is_null());
-    let engine = Box::leak(Box::from_raw(engine));
+    let engine = &*engine;
     let blocker_result = engine.check_network_urls_with_hostnames_subset(
         url,
         host,
@@ -115,23 +177,16 @@ pub unsafe extern "C" fn engine_match(
     };
 }
 
-/// Returns any CSP directives that should be added to a subdocument or document request's response
-/// headers.
-#[no_mangle]
-pub unsafe extern "C" fn engine_get_csp_directives(
+unsafe fn engine_get_csp_directives_str(
     engine: *mut Engine,
-    url: *const c_char,
-    host: *const c_char,
-    tab_host: *const c_char,
+    url: &str,
+    host: &str,
+    tab_host: &str,
     third_party: bool,
-    resource_type: *const c_char,
+    resource_type: &str,
 ) -> *mut c_char {
-    let url = CStr::from_ptr(url).to_str().unwrap();
-    let host = CStr::from_ptr(host).to_str().unwrap();
-    let tab_host = CStr::from_ptr(tab_host).to_str().unwrap();
-    let resource_type = CStr::from_ptr(resource_type).to_str().unwrap();
     assert!(!engine.is_null());
-    let engine = Box::leak(Box::from_raw(engine));
+    let engine = &*engine;
     if let Some(directive) = engine.get_csp_directives(url, host, tab_host, resource_type, Some(third_party)) {
         let ptr = CString::new(directive)
             .expect("Error: CString::new()")
@@ -147,6 +202,117 @@ pub unsafe extern "C" fn engine_get_csp_directives(
     }
 }
 
+/// Checks if a `url` matches for the specified `Engine` within the context.
+///
+/// This API is designed for multi-engine use, so block results are used both as inputs and
+/// outputs. They will be updated to reflect additional checking within this engine, rather than
+/// being replaced with results just for this engine.
+#[no_mangle]
+pub unsafe extern "C" fn engine_match(
+    engine: *mut Engine,
+    url: *const c_char,
+    host: *const c_char,
+    tab_host: *const c_char,
+    third_party: bool,
+    resource_type: *const c_char,
+    did_match_rule: *mut bool,
+    did_match_exception: *mut bool,
+    did_match_important: *mut bool,
+    redirect: *mut *mut c_char,
+) {
+    let url = CStr::from_ptr(url).to_str().unwrap();
+    let host = CStr::from_ptr(host).to_str().unwrap();
+    let tab_host = CStr::from_ptr(tab_host).to_str().unwrap();
+    let resource_type = CStr::from_ptr(resource_type).to_str().unwrap();
+    engine_match_str(
+        engine,
+        url,
+        host,
+        tab_host,
+        third_party,
+        resource_type,
+        did_match_rule,
+        did_match_exception,
+        did_match_important,
+        redirect,
+    );
+}
+
+/// Same as `engine_match`, but borrows its string inputs as (pointer, length) pairs which do not
+/// need to be NUL-terminated, and takes the request type as a code rather than a string. Nothing is
+/// copied on the caller's side.
+#[no_mangle]
+pub unsafe extern "C" fn engine_match_slices(
+    engine: *mut Engine,
+    url: *const c_char,
+    url_len: size_t,
+    host: *const c_char,
+    host_len: size_t,
+    tab_host: *const c_char,
+    tab_host_len: size_t,
+    third_party: bool,
+    resource_type: u8,
+    did_match_rule: *mut bool,
+    did_match_exception: *mut bool,
+    did_match_important: *mut bool,
+    redirect: *mut *mut c_char,
+) {
+    engine_match_str(
+        engine,
+        str_from_raw_parts(url, url_len),
+        str_from_raw_parts(host, host_len),
+        str_from_raw_parts(tab_host, tab_host_len),
+        third_party,
+        resource_type_from_code(resource_type),
+        did_match_rule,
+        did_match_exception,
+        did_match_important,
+        redirect,
+    );
+}
+
+/// Returns any CSP directives that should be added to a subdocument or document request's response
+/// headers.
+#[no_mangle]
+pub unsafe extern "C" fn engine_get_csp_directives(
+    engine: *mut Engine,
+    url: *const c_char,
+    host: *const c_char,
+    tab_host: *const c_char,
+    third_party: bool,
+    resource_type: *const c_char,
+) -> *mut c_char {
+    let url = CStr::from_ptr(url).to_str().unwrap();
+    let host = CStr::from_ptr(host).to_str().unwrap();
+    let tab_host = CStr::from_ptr(tab_host).to_str().unwrap();
+    let resource_type = CStr::from_ptr(resource_type).to_str().unwrap();
+    engine_get_csp_directives_str(engine, url, host, tab_host, third_party, resource_type)
+}
+
+/// Same as `engine_get_csp_directives`, but with borrowed (pointer, length) string inputs and a
+/// request type code.
+#[no_mangle]
+pub unsafe extern "C" fn engine_get_csp_directives_slices(
+    engine: *mut Engine,
+    url: *const c_char,
+    url_len: size_t,
+    host: *const c_char,
+    host_len: size_t,
+    tab_host: *const c_char,
+    tab_host_len: size_t,
+    third_party: bool,
+    resource_type: u8,
+) -> *mut c_char {
+    engine_get_csp_directives_str(
+        engine,
+        str_from_raw_parts(url, url_len),
+        str_from_raw_parts(host, host_len),
+        str_from_raw_parts(tab_host, tab_host_len),
+        third_party,
+        resource_type_from_code(resource_type),
+    )
+}
+
 /// Adds a tag to the engine for consideration
 #[no_mangle]
 pub unsafe extern "C" fn engine_add_tag(engine: *mut Engine, tag: *const c_char) {
@@ -161,7 +327,7 @@ pub unsafe extern "C" fn engine_add_tag(engine: *mut Engine, tag: *const c_char)
 pub unsafe extern "C" fn engine_tag_exists(engine: *mut Engine, tag: *const c_char) -> bool {
     let tag = CStr::from_ptr(tag).to_str().unwrap();
     assert!(!engine.is_null());
-    let engine = Box::leak(Box::from_raw(engine));
+    let engine = &*engine;
     engine.tag_exists(tag)
 }
 
@@ -209,6 +375,29 @@ pub unsafe extern "C" fn engine_remove_tag(engine: *mut Engine, tag: *const c_ch
     engine.disable_tags(&[tag]);
 }
 
+/// Creates an independent copy of `engine` by round-tripping it through its serialized form, so
+/// that the copy can be modified while other threads keep matching against the original. Enabled
+/// tags and resources are not guaranteed to carry over and should be added to the copy again.
+/// Returns null if the engine could not be copied.
+#[no_mangle]
+pub unsafe extern "C" fn engine_clone(engine: *mut Engine) -> *mut Engine {
+    assert!(!engine.is_null());
+    let engine = &*engine;
+    let data = match engine.serialize() {
+        Ok(data) => data,
+        Err(_) => {
+            eprintln!("Error serializing adblock engine");
+            return ptr::null_mut();
+        }
+    };
+    let mut copy = Engine::from_filter_set(adblock::lists::FilterSet::new(false), true);
+    if copy.deserialize(&data).is_err() {
+        eprintln!("Error deserializing adblock engine");
+        return ptr::null_mut();
+    }
+    Box::into_raw(Box::new(copy))
+}
+
 /// Deserializes a previously serialized data file list.
 #[no_mangle]
 pub unsafe extern "C" fn engine_deserialize(
@@ -250,7 +439,7 @@ pub unsafe extern "C" fn engine_url_cosmetic_resources(
 ) -> *mut c_char {
     let url = CStr::from_ptr(url).to_str().unwrap();
     assert!(!engine.is_null());
-    let engine = Box::leak(Box::from_raw(engine));
+    let engine = &*engine;
     let ptr = CString::new(serde_json::to_string(&engine.url_cosmetic_resources(url))
         .unwrap_or_else(|_| "".into()))
         .expect("Error: CString::new()")
@@ -259,6 +448,80 @@ pub unsafe extern "C" fn engine_url_cosmetic_resources(
     ptr
 }
 
+/// The part of a url-specific cosmetic resources result that is handed to a
+/// `CosmeticResourceVisitor`.
+#[repr(u8)]
+#[derive(Clone, Copy)]
+pub enum CosmeticResourceKind {
+    /// A hide selector, in `key`.
+    HideSelector = 0,
+    /// A style selector in `key` with one of its declarations in `value`.
+    StyleSelector = 1,
+    /// An exception, in `key`.
+    Exception = 2,
+    /// The injected scriptlet code, in `key`.
+    InjectedScript = 3,
+    /// The page has `generichide` set.
+    GenericHide = 4,
+}
+
+/// Receives one entry of a url-specific cosmetic resources result, of the given `kind`. Strings
+/// are borrowed for the duration of the call only and are not NUL-terminated.
+pub type CosmeticResourceVisitor = unsafe extern "C" fn(
+    context: *mut c_void,
+    kind: CosmeticResourceKind,
+    key: *const c_char,
+    key_len: size_t,
+    value: *const c_char,
+    value_len: size_t,
+);
+
+/// Receives one selector of a result. The string is borrowed for the duration of the call only
+/// and is not NUL-terminated.
+pub type SelectorVisitor =
+    unsafe extern "C" fn(context: *mut c_void, selector: *const c_char, selector_len: size_t);
+
+/// Same as `engine_url_cosmetic_resources`, but hands each part of the result to `visitor`
+/// instead of serializing it to JSON.
+#[no_mangle]
+pub unsafe extern "C" fn engine_url_cosmetic_resources_visit(
+    engine: *mut Engine,
+    url: *const c_char,
+    url_len: size_t,
+    visitor: CosmeticResourceVisitor,
+    context: *mut c_void,
+) {
+    let url = str_from_raw_parts(url, url_len);
+    assert!(!engine.is_null());
+    let engine = &*engine;
+    let resources = engine.url_cosmetic_resources(url);
+    let visit = |kind: CosmeticResourceKind, key: &str, value: &str| {
+        visitor(
+            context,
+            kind,
+            key.as_ptr() as *const c_char,
+            key.len(),
+            value.as_ptr() as *const c_char,
+            value.len(),
+        )
+    };
+    for selector in resources.hide_selectors.iter() {
+        visit(CosmeticResourceKind::HideSelector, selector, "");
+    }
+    for (selector, styles) in resources.style_selectors.iter() {
+        for style in styles.iter() {
+            visit(CosmeticResourceKind::StyleSelector, selector, style);
+        }
+    }
+    for exception in resources.exceptions.iter() {
+        visit(CosmeticResourceKind::Exception, exception, "");
+    }
+    visit(CosmeticResourceKind::InjectedScript, &resources.injected_script, "");
+    if resources.generichide {
+        visit(CosmeticResourceKind::GenericHide, "", "");
+    }
+}
+
 /// Returns a stylesheet containing all generic cosmetic rules that begin with any of the provided class and id selectors
 ///
 /// The leading '.' or '#' character should not be provided
@@ -285,7 +548,40 @@ pub unsafe extern "C" fn engine_hidden_class_id_selectors(
         .map(|index| CStr::from_ptr(exceptions[index]).to_str().unwrap().to_owned())
         .collect();
     assert!(!engine.is_null());
-    let engine = Box::leak(Box::from_raw(engine));
+    let engine = &*engine;
     let stylesheet = engine.hidden_class_id_selectors(&classes, &ids, &exceptions);
     CString::new(serde_json::to_string(&stylesheet).unwrap_or_else(|_| "".into())).expect("Error: CString::new()").into_raw()
 }
+
+/// Same as `engine_hidden_class_id_selectors`, but hands each selector to `visitor` instead of
+/// serializing them to JSON.
+#[no_mangle]
+pub unsafe extern "C" fn engine_hidden_class_id_selectors_visit(
+    engine: *mut Engine,
+    classes: *const *const c_char,
+    classes_size: size_t,
+    ids: *const *const c_char,
+    ids_size: size_t,
+    exceptions: *const *const c_char,
+    exceptions_size: size_t,
+    visitor: SelectorVisitor,
+    context: *mut c_void,
+) {
+    let classes = std::slice::from_raw_parts(classes, classes_size);
+    let classes: Vec<String> = (0..classes_size)
+        .map(|index| CStr::from_ptr(classes[index]).to_str().unwrap().to_owned())
+        .collect();
+    let ids = std::slice::from_raw_parts(ids, ids_size);
+    let ids: Vec<String> = (0..ids_size)
+        .map(|index| CStr::from_ptr(ids[index]).to_str().unwrap().to_owned())
+        .collect();
+    let exceptions = std::slice::from_raw_parts(exceptions, exceptions_size);
+    let exceptions: std::collections::HashSet<String> = (0..exceptions_size)
+        .map(|index| CStr::from_ptr(exceptions[index]).to_str().unwrap().to_owned())
+        .collect();
+    assert!(!engine.is_null());
+    let engine = &*engine;
+    for selector in engine.hidden_class_id_selectors(&classes, &ids, &exceptions).iter() {
+        visitor(context, selector.as_ptr() as *const c_char, selector.len());
+    }
+}
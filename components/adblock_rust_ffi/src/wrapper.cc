@@ -12,6 +12,50 @@ extern "C" {
 
 namespace adblock {
 
+namespace {
+
+std::vector<const char*> ToRawStrings(const std::vector<std::string>& strings) {
+  std::vector<const char*> strings_raw;
+  strings_raw.reserve(strings.size());
+  for (const auto& string : strings)
+    strings_raw.push_back(string.c_str());
+  return strings_raw;
+}
+
+void VisitCosmeticResource(void* context,
+                           C_CosmeticResourceKind kind,
+                           const char* key,
+                           size_t key_len,
+                           const char* value,
+                           size_t value_len) {
+  CosmeticResources* resources = static_cast<CosmeticResources*>(context);
+  switch (kind) {
+    case C_CosmeticResourceKind_HideSelector:
+      resources->hide_selectors.emplace_back(key, key_len);
+      break;
+    case C_CosmeticResourceKind_StyleSelector:
+      resources->style_selectors[std::string(key, key_len)].emplace_back(
+          value, value_len);
+      break;
+    case C_CosmeticResourceKind_Exception:
+      resources->exceptions.emplace_back(key, key_len);
+      break;
+    case C_CosmeticResourceKind_InjectedScript:
+      resources->injected_script.assign(key, key_len);
+      break;
+    case C_CosmeticResourceKind_GenericHide:
+      resources->generichide = true;
+      break;
+  }
+}
+
+void VisitSelector(void* context, const char* selector, size_t selector_len) {
+  static_cast<std::vector<std::string>*>(context)->emplace_back(selector,
+                                                                 selector_len);
+}
+
+}  // namespace
+
 bool SetDomainResolver(DomainResolverCallback resolver) {
   return set_domain_resolver(resolver);
 }
@@ -40,6 +84,12 @@ FilterList::FilterList(const FilterList& other) = default;
 
 FilterList::~FilterList() {}
 
+CosmeticResources::CosmeticResources() = default;
+CosmeticResources::CosmeticResources(CosmeticResources&& other) = default;
+CosmeticResources& CosmeticResources::operator=(CosmeticResources&& other) =
+    default;
+CosmeticResources::~CosmeticResources() = default;
+
 Engine::Engine() : raw(engine_create("")) {}
 
 Engine::Engine(const std::string& rules) : raw(engine_create(rules.c_str())) {}
@@ -47,6 +97,24 @@ Engine::Engine(const std::string& rules) : raw(engine_create(rules.c_str())) {}
 Engine::Engine(const char* data, size_t data_size)
     : raw(engine_create_from_buffer(data, data_size)) {}
 
+Engine::Engine(C_Engine* raw_engine) : raw(raw_engine) {}
+
+Engine::Engine(const std::vector<std::string>& rule_lists,
+               bool include_network,
+               bool include_cosmetic) {
+  std::vector<const char*> data;
+  std::vector<size_t> data_sizes;
+  data.reserve(rule_lists.size());
+  data_sizes.reserve(rule_lists.size());
+  for (const auto& rules : rule_lists) {
+    data.push_back(rules.data());
+    data_sizes.push_back(rules.size());
+  }
+  raw = engine_create_from_buffers(data.data(), data_sizes.data(),
+                                   rule_lists.size(), include_network,
+                                   include_cosmetic);
+}
+
 void Engine::matches(const std::string& url,
                      const std::string& host,
                      const std::string& tab_host,
@@ -82,6 +150,56 @@ std::string Engine::getCspDirectives(const std::string& url,
   return csp;
 }
 
+void Engine::matches(const char* url,
+                     size_t url_len,
+                     const char* host,
+                     size_t host_len,
+                     const char* tab_host,
+                     size_t tab_host_len,
+                     bool is_third_party,
+                     ResourceType resource_type,
+                     bool* did_match_rule,
+                     bool* did_match_exception,
+                     bool* did_match_important,
+                     std::string* redirect) const {
+  char* redirect_char_ptr = nullptr;
+  engine_match_slices(raw, url, url_len, host, host_len, tab_host,
+                      tab_host_len, is_third_party,
+                      static_cast<uint8_t>(resource_type), did_match_rule,
+                      did_match_exception, did_match_important,
+                      &redirect_char_ptr);
+  if (redirect_char_ptr) {
+    if (redirect) {
+      *redirect = redirect_char_ptr;
+    }
+    c_char_buffer_destroy(redirect_char_ptr);
+  }
+}
+
+std::string Engine::getCspDirectives(const char* url,
+                                     size_t url_len,
+                                     const char* host,
+                                     size_t host_len,
+                                     const char* tab_host,
+                                     size_t tab_host_len,
+                                     bool is_third_party,
+                                     ResourceType resource_type) const {
+  char* csp_raw = engine_get_csp_directives_slices(
+      raw, url, url_len, host, host_len, tab_host, tab_host_len,
+      is_third_party, static_cast<uint8_t>(resource_type));
+  const std::string csp = std::string(csp_raw);
+
+  c_char_buffer_destroy(csp_raw);
+  return csp;
+}
+
+std::unique_ptr<Engine> Engine::clone() const {
+  C_Engine* copy = engine_clone(raw);
+  if (!copy)
+    return nullptr;
+  return std::unique_ptr<Engine>(new Engine(copy));
+}
+
 bool Engine::deserialize(const char* data, size_t data_size) {
   return engine_deserialize(raw, data, data_size);
 }
@@ -147,6 +265,26 @@ const std::string Engine::hiddenClassIdSelectors(
   return stylesheet;
 }
 
+void Engine::urlCosmeticResources(const char* url,
+                                  size_t url_len,
+                                  CosmeticResources* resources) const {
+  engine_url_cosmetic_resources_visit(raw, url, url_len, &VisitCosmeticResource,
+                                      resources);
+}
+
+void Engine::hiddenClassIdSelectors(const std::vector<std::string>& classes,
+                                    const std::vector<std::string>& ids,
+                                    const std::vector<std::string>& exceptions,
+                                    std::vector<std::string>* selectors) const {
+  const std::vector<const char*> classes_raw = ToRawStrings(classes);
+  const std::vector<const char*> ids_raw = ToRawStrings(ids);
+  const std::vector<const char*> exceptions_raw = ToRawStrings(exceptions);
+  engine_hidden_class_id_selectors_visit(
+      raw, classes_raw.data(), classes_raw.size(), ids_raw.data(),
+      ids_raw.size(), exceptions_raw.data(), exceptions_raw.size(),
+      &VisitSelector, selectors);
+}
+
 Engine::~Engine() {
   engine_destroy(raw);
 }
@@ -5,6 +5,10 @@
 
 #ifndef BRAVE_COMPONENTS_ADBLOCK_RUST_FFI_SRC_WRAPPER_H_
 #define BRAVE_COMPONENTS_ADBLOCK_RUST_FFI_SRC_WRAPPER_H_
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -37,6 +41,39 @@ typedef C_DomainResolverCallback DomainResolverCallback;
 
 bool ADBLOCK_EXPORT SetDomainResolver(DomainResolverCallback resolver);
 
+// Request types passed to the slice-based matching APIs. The values are part
+// of the FFI and must stay in sync with resource_type_from_code() in lib.rs.
+enum class ResourceType : uint8_t {
+  kUnknown = 0,
+  kMainFrame = 1,
+  kSubFrame = 2,
+  kStylesheet = 3,
+  kScript = 4,
+  kImage = 5,
+  kFont = 6,
+  kOther = 7,
+  kObject = 8,
+  kMedia = 9,
+  kXhr = 10,
+  kPing = 11,
+};
+
+// Url-specific cosmetic resources of a single engine, as returned by the
+// structured overload of Engine::urlCosmeticResources().
+struct ADBLOCK_EXPORT CosmeticResources {
+  CosmeticResources();
+  CosmeticResources(CosmeticResources&& other);
+  CosmeticResources& operator=(CosmeticResources&& other);
+  ~CosmeticResources();
+
+  std::vector<std::string> hide_selectors;
+  // Maps a selector to the CSS declarations applied to it.
+  std::map<std::string, std::vector<std::string>> style_selectors;
+  std::vector<std::string> exceptions;
+  std::string injected_script;
+  bool generichide = false;
+};
+
 class ADBLOCK_EXPORT FilterList {
  public:
   FilterList(const std::string& uuid,
@@ -64,11 +101,16 @@ class ADBLOCK_EXPORT FilterList {
   static std::vector<FilterList> regional_list;
 };
 
+// The const methods only read the engine, so they can be called from several
+// threads at once as long as nothing modifies the engine meanwhile.
 class ADBLOCK_EXPORT Engine {
  public:
   Engine();
   explicit Engine(const std::string& rules);
   Engine(const char* data, size_t data_size);
+  Engine(const std::vector<std::string>& rule_lists,
+         bool include_network,
+         bool include_cosmetic);
   void matches(const std::string& url,
                const std::string& host,
                const std::string& tab_host,
@@ -83,6 +125,34 @@ class ADBLOCK_EXPORT Engine {
                                const std::string& tab_host,
                                bool is_third_party,
                                const std::string& resource_type);
+  // Variants of the above that borrow their inputs as (pointer, length)
+  // slices, which need not be NUL-terminated, so that callers can pass views
+  // into existing buffers without copying. |redirect| is only written when a
+  // redirect rule matches.
+  void matches(const char* url,
+               size_t url_len,
+               const char* host,
+               size_t host_len,
+               const char* tab_host,
+               size_t tab_host_len,
+               bool is_third_party,
+               ResourceType resource_type,
+               bool* did_match_rule,
+               bool* did_match_exception,
+               bool* did_match_important,
+               std::string* redirect) const;
+  std::string getCspDirectives(const char* url,
+                               size_t url_len,
+                               const char* host,
+                               size_t host_len,
+                               const char* tab_host,
+                               size_t tab_host_len,
+                               bool is_third_party,
+                               ResourceType resource_type) const;
+  // Returns an independent copy of this engine that can be modified while
+  // other threads keep using this one, or null on failure. Tags and resources
+  // have to be added to the copy again.
+  std::unique_ptr<Engine> clone() const;
   bool deserialize(const char* data, size_t data_size);
   void addTag(const std::string& tag);
   void addResource(const std::string& key,
@@ -92,13 +162,23 @@ class ADBLOCK_EXPORT Engine {
   void removeTag(const std::string& tag);
   bool tagExists(const std::string& tag);
   const std::string urlCosmeticResources(const std::string& url);
+  // Structured variants of urlCosmeticResources() and
+  // hiddenClassIdSelectors(), which skip the JSON round trip.
+  void urlCosmeticResources(const char* url,
+                            size_t url_len,
+                            CosmeticResources* resources) const;
   const std::string hiddenClassIdSelectors(
       const std::vector<std::string>& classes,
       const std::vector<std::string>& ids,
       const std::vector<std::string>& exceptions);
+  void hiddenClassIdSelectors(const std::vector<std::string>& classes,
+                              const std::vector<std::string>& ids,
+                              const std::vector<std::string>& exceptions,
+                              std::vector<std::string>* selectors) const;
   ~Engine();
 
  private:
+  explicit Engine(C_Engine* raw_engine);
   Engine(const Engine&) = delete;
   void operator=(const Engine&) = delete;
   C_Engine* raw;
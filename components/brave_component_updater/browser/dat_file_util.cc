@@ -10,6 +10,7 @@
 #include "base/logging.h"
 #include "base/files/file_path.h"
 #include "base/files/file_util.h"
+#include "base/files/memory_mapped_file.h"
 
 namespace brave_component_updater {
 
@@ -44,4 +45,15 @@ std::string GetDATFileAsString(const base::FilePath& file_path) {
   return contents;
 }
 
+bool MapDATFile(const base::FilePath& file_path,
+                base::MemoryMappedFile* mapped_file) {
+  if (!mapped_file->Initialize(file_path) || mapped_file->length() == 0) {
+    LOG(ERROR) << "MapDATFile: "
+               << "the dat file is not found or corrupted "
+               << file_path;
+    return false;
+  }
+  return true;
+}
+
 }  // namespace brave_component_updater
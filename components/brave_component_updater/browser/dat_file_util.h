@@ -12,6 +12,7 @@
 #include <vector>
 
 #include "base/files/file_path.h"
+#include "base/files/memory_mapped_file.h"
 
 namespace brave_component_updater {
 
@@ -19,6 +20,10 @@ using DATFileDataBuffer = std::vector<unsigned char>;
 
 void GetDATFileData(const base::FilePath& file_path, DATFileDataBuffer* buffer);
 std::string GetDATFileAsString(const base::FilePath& file_path);
+// Maps |file_path| read-only into |mapped_file|. Returns false, and logs, if
+// the file is missing, empty or cannot be mapped.
+bool MapDATFile(const base::FilePath& file_path,
+                base::MemoryMappedFile* mapped_file);
 
 template <typename T>
 using LoadDATFileDataResult =
@@ -50,6 +55,33 @@ LoadDATFileDataResult<T> LoadRawFileData(const base::FilePath& dat_file_path) {
   return LoadDATFileDataResult<T>(std::move(client), std::move(buffer));
 }
 
+// Same as LoadDATFileData, but |T| is deserialized straight from a read-only
+// mapping of the file, which is released as soon as this returns. The file is
+// never copied onto the heap, so only the deserialized |T| outlives the call,
+// and the mapped pages are clean and can be dropped by the OS under pressure.
+template <typename T>
+std::unique_ptr<T> LoadMappedDATFileData(const base::FilePath& dat_file_path) {
+  base::MemoryMappedFile mapped_file;
+  if (!MapDATFile(dat_file_path, &mapped_file))
+    return nullptr;
+  std::unique_ptr<T> client = std::make_unique<T>();
+  if (!client->deserialize(reinterpret_cast<const char*>(mapped_file.data()),
+                           mapped_file.length()))
+    client.reset();
+  return client;
+}
+
+// Same as LoadRawFileData, but |T| is constructed from a read-only mapping of
+// the file.
+template <typename T>
+std::unique_ptr<T> LoadMappedRawFileData(const base::FilePath& dat_file_path) {
+  base::MemoryMappedFile mapped_file;
+  if (!MapDATFile(dat_file_path, &mapped_file))
+    return nullptr;
+  return std::make_unique<T>(reinterpret_cast<const char*>(mapped_file.data()),
+                             mapped_file.length());
+}
+
 }  // namespace brave_component_updater
 
 #endif  // BRAVE_COMPONENTS_BRAVE_COMPONENT_UPDATER_BROWSER_DAT_FILE_UTIL_H_
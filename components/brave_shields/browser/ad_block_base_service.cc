@@ -13,104 +13,36 @@
 
 #include "base/bind.h"
 #include "base/files/file_path.h"
-#include "base/json/json_reader.h"
+#include "base/files/file_util.h"
 #include "base/macros.h"
 #include "base/memory/ptr_util.h"
+#include "base/strings/string_piece.h"
 #include "base/strings/utf_string_conversions.h"
 #include "base/task/post_task.h"
 #include "base/task/thread_pool.h"
 #include "brave/components/adblock_rust_ffi/src/wrapper.h"
 #include "brave/components/brave_component_updater/browser/dat_file_util.h"
+#include "brave/components/brave_shields/browser/ad_block_decision_cache.h"
+#include "brave/components/brave_shields/browser/ad_block_engine_merger.h"
+#include "brave/components/brave_shields/browser/ad_block_service_helper.h"
 #include "brave/components/brave_shields/common/brave_shield_constants.h"
 #include "content/public/browser/browser_task_traits.h"
 #include "content/public/browser/browser_thread.h"
-#include "net/base/registry_controlled_domains/registry_controlled_domain.h"
 #include "third_party/abseil-cpp/absl/types/optional.h"
-#include "url/origin.h"
+#include "url/gurl.h"
 
 using brave_component_updater::BraveComponent;
 using content::BrowserThread;
-using namespace net::registry_controlled_domains;  // NOLINT
-
-namespace {
-
-std::string ResourceTypeToString(blink::mojom::ResourceType resource_type) {
-  std::string filter_option = "";
-  switch (resource_type) {
-    // top level page
-    case blink::mojom::ResourceType::kMainFrame:
-      filter_option = "main_frame";
-      break;
-    // frame or iframe
-    case blink::mojom::ResourceType::kSubFrame:
-      filter_option = "sub_frame";
-      break;
-    // a CSS stylesheet
-    case blink::mojom::ResourceType::kStylesheet:
-      filter_option = "stylesheet";
-      break;
-    // an external script
-    case blink::mojom::ResourceType::kScript:
-      filter_option = "script";
-      break;
-    // an image (jpg/gif/png/etc)
-    case blink::mojom::ResourceType::kFavicon:
-    case blink::mojom::ResourceType::kImage:
-      filter_option = "image";
-      break;
-    // a font
-    case blink::mojom::ResourceType::kFontResource:
-      filter_option = "font";
-      break;
-    // an "other" subresource.
-    case blink::mojom::ResourceType::kSubResource:
-      filter_option = "other";
-      break;
-    // an object (or embed) tag for a plugin.
-    case blink::mojom::ResourceType::kObject:
-      filter_option = "object";
-      break;
-    // a media resource.
-    case blink::mojom::ResourceType::kMedia:
-      filter_option = "media";
-      break;
-    // a XMLHttpRequest
-    case blink::mojom::ResourceType::kXhr:
-      filter_option = "xhr";
-      break;
-    // a ping request for <a ping>/sendBeacon.
-    case blink::mojom::ResourceType::kPing:
-      filter_option = "ping";
-      break;
-    // the main resource of a dedicated worker.
-    case blink::mojom::ResourceType::kWorker:
-    // the main resource of a shared worker.
-    case blink::mojom::ResourceType::kSharedWorker:
-    // an explicitly requested prefetch
-    case blink::mojom::ResourceType::kPrefetch:
-    // the main resource of a service worker.
-    case blink::mojom::ResourceType::kServiceWorker:
-    // a report of Content Security Policy violations.
-    case blink::mojom::ResourceType::kCspReport:
-    // a resource that a plugin requested.
-    case blink::mojom::ResourceType::kPluginResource:
-    default:
-      break;
-  }
-  return filter_option;
-}
-
-}  // namespace
 
 namespace brave_shields {
 
 AdBlockBaseService::AdBlockBaseService(BraveComponent::Delegate* delegate)
-    : BaseBraveShieldsService(delegate),
-      ad_block_client_(new adblock::Engine()),
-      weak_factory_(this) {}
+    : BaseBraveShieldsService(delegate), weak_factory_(this) {
+  ad_block_client_.Publish(std::make_unique<adblock::Engine>());
+}
 
 AdBlockBaseService::~AdBlockBaseService() {
-  GetTaskRunner()->DeleteSoon(FROM_HERE, ad_block_client_.release());
+  GetTaskRunner()->ReleaseSoon(FROM_HERE, ad_block_client_.Get());
 }
 
 void AdBlockBaseService::ShouldStartRequest(
@@ -122,20 +54,22 @@ void AdBlockBaseService::ShouldStartRequest(
     bool* did_match_exception,
     bool* did_match_important,
     std::string* mock_data_url) {
-  DCHECK(GetTaskRunner()->RunsTasksInCurrentSequence());
   // if (!IsInitialized())
   //   return;
 
+  const scoped_refptr<SharedAdBlockEngine> engine = ad_block_client_.Get();
+  // The network rules of merged lists are matched by the combined engine.
+  if (engine->network_rules_merged())
+    return;
+
   // Determine third-party here so the library doesn't need to figure it out.
-  // CreateFromNormalizedTuple is needed because SameDomainOrHost needs
-  // a URL or origin and not a string to a host name.
-  bool is_third_party = !SameDomainOrHost(
-      url,
-      url::Origin::CreateFromNormalizedTuple("https", tab_host.c_str(), 80),
-      INCLUDE_PRIVATE_REGISTRIES);
-  ad_block_client_->matches(
-      url.spec(), url.host(), tab_host, is_third_party,
-      ResourceTypeToString(resource_type), did_match_rule,
+  // The engine borrows the url, host and tab host, so nothing is copied here.
+  const std::string& spec = url.spec();
+  const base::StringPiece host = url.host_piece();
+  engine->engine().matches(
+      spec.data(), spec.size(), host.data(), host.size(), tab_host.data(),
+      tab_host.size(), IsThirdPartyRequest(url, tab_host),
+      ResourceTypeToEngineType(resource_type), did_match_rule,
       did_match_exception, did_match_important, mock_data_url);
 
   // LOG(ERROR) << "AdBlockBaseService::ShouldStartRequest(), host: "
@@ -148,18 +82,16 @@ absl::optional<std::string> AdBlockBaseService::GetCspDirectives(
     const GURL& url,
     blink::mojom::ResourceType resource_type,
     const std::string& tab_host) {
-  DCHECK(GetTaskRunner()->RunsTasksInCurrentSequence());
+  const scoped_refptr<SharedAdBlockEngine> engine = ad_block_client_.Get();
+  if (engine->network_rules_merged())
+    return absl::nullopt;
 
-  // Determine third-party here so the library doesn't need to figure it out.
-  // CreateFromNormalizedTuple is needed because SameDomainOrHost needs
-  // a URL or origin and not a string to a host name.
-  bool is_third_party = !SameDomainOrHost(
-      url,
-      url::Origin::CreateFromNormalizedTuple("https", tab_host.c_str(), 80),
-      INCLUDE_PRIVATE_REGISTRIES);
-  const std::string result = ad_block_client_->getCspDirectives(
-      url.spec(), url.host(), tab_host, is_third_party,
-      ResourceTypeToString(resource_type));
+  const std::string& spec = url.spec();
+  const base::StringPiece host = url.host_piece();
+  const std::string result = engine->engine().getCspDirectives(
+      spec.data(), spec.size(), host.data(), host.size(), tab_host.data(),
+      tab_host.size(), IsThirdPartyRequest(url, tab_host),
+      ResourceTypeToEngineType(resource_type));
 
   if (result.empty()) {
     return absl::nullopt;
@@ -170,53 +102,58 @@ absl::optional<std::string> AdBlockBaseService::GetCspDirectives(
 
 void AdBlockBaseService::EnableTag(const std::string& tag, bool enabled) {
   if (BrowserThread::CurrentlyOn(BrowserThread::UI)) {
-    GetTaskRunner()->PostTask(
-        FROM_HERE, base::BindOnce(&AdBlockBaseService::EnableTag,
-                                  base::Unretained(this), tag, enabled));
+    PostEngineChange(base::BindOnce(&AdBlockBaseService::EnableTag,
+                                    base::Unretained(this), tag, enabled));
     return;
   }
 
   if (enabled) {
-    if (tags_.find(tag) == tags_.end()) {
-      ad_block_client_->addTag(tag);
-      tags_.insert(tag);
-    }
+    if (!tags_.insert(tag).second)
+      return;
+    removed_tags_.erase(tag);
   } else {
-    ad_block_client_->removeTag(tag);
-    std::set<std::string>::iterator it =
-        std::find(tags_.begin(), tags_.end(), tag);
-    if (it != tags_.end()) {
-      tags_.erase(it);
-    }
+    if (tags_.erase(tag) == 0)
+      return;
+    removed_tags_.insert(tag);
   }
+  MaybeRepublishAdBlockClient();
 }
 
 void AdBlockBaseService::AddResources(const std::string& resources) {
   if (BrowserThread::CurrentlyOn(BrowserThread::UI)) {
-    GetTaskRunner()->PostTask(
-        FROM_HERE, base::BindOnce(&AdBlockBaseService::AddResources,
-                                  base::Unretained(this), resources));
+    PostEngineChange(base::BindOnce(&AdBlockBaseService::AddResources,
+                                    base::Unretained(this), resources));
     return;
   }
 
-  ad_block_client_->addResources(resources);
   resources_ = resources;
+  MaybeRepublishAdBlockClient();
+}
+
+void AdBlockBaseService::SetEngineMerger(AdBlockEngineMerger* merger,
+                                         const std::string& source_id) {
+  engine_merger_ = merger;
+  merger_source_id_ = source_id;
 }
 
 bool AdBlockBaseService::TagExists(const std::string& tag) {
   return std::find(tags_.begin(), tags_.end(), tag) != tags_.end();
 }
 
-absl::optional<base::Value> AdBlockBaseService::UrlCosmeticResources(
-    const std::string& url) {
+cosmetic_filters::mojom::CosmeticResourcesPtr
+AdBlockBaseService::UrlCosmeticResources(const std::string& url) {
   // if (!IsInitialized())
   //   return;
 
   DCHECK(GetTaskRunner()->RunsTasksInCurrentSequence());
-  return base::JSONReader::Read(ad_block_client_->urlCosmeticResources(url));
+  adblock::CosmeticResources resources;
+  ad_block_client_.Get()->engine().urlCosmeticResources(url.data(), url.size(),
+                                                        &resources);
+  return ToCosmeticResources(std::move(resources));
 }
 
-absl::optional<base::Value> AdBlockBaseService::HiddenClassIdSelectors(
+cosmetic_filters::mojom::CosmeticResourcesPtr
+AdBlockBaseService::HiddenClassIdSelectors(
     const std::vector<std::string>& classes,
     const std::vector<std::string>& ids,
     const std::vector<std::string>& exceptions) {
@@ -224,57 +161,189 @@ absl::optional<base::Value> AdBlockBaseService::HiddenClassIdSelectors(
   //   return;
 
   DCHECK(GetTaskRunner()->RunsTasksInCurrentSequence());
-  return base::JSONReader::Read(
-      ad_block_client_->hiddenClassIdSelectors(classes, ids, exceptions));
+  auto resources = cosmetic_filters::mojom::CosmeticResources::New();
+  ad_block_client_.Get()->engine().hiddenClassIdSelectors(
+      classes, ids, exceptions, &resources->hide_selectors);
+  return resources;
 }
 
 void AdBlockBaseService::GetDATFileData(const base::FilePath& dat_file_path,
                                         bool deserialize,
                                         base::OnceClosure callback) {
+  if (engine_merger_) {
+    base::ThreadPool::PostTaskAndReplyWithResult(
+        FROM_HERE, {base::MayBlock()},
+        base::BindOnce(&AdBlockBaseService::LoadMergeableListData,
+                       dat_file_path, deserialize),
+        base::BindOnce(&AdBlockBaseService::OnGetMergeableListData,
+                       weak_factory_.GetWeakPtr(), std::move(callback)));
+    return;
+  }
+
   base::ThreadPool::PostTaskAndReplyWithResult(
       FROM_HERE, {base::MayBlock()},
       base::BindOnce(
           deserialize
-              ? &brave_component_updater::LoadDATFileData<adblock::Engine>
-              : &brave_component_updater::LoadRawFileData<adblock::Engine>,
+              ? &brave_component_updater::LoadMappedDATFileData<
+                    adblock::Engine>
+              : &brave_component_updater::LoadMappedRawFileData<
+                    adblock::Engine>,
           dat_file_path),
       base::BindOnce(&AdBlockBaseService::OnGetDATFileData,
                      weak_factory_.GetWeakPtr(), std::move(callback)));
 }
 
-void AdBlockBaseService::OnGetDATFileData(base::OnceClosure callback,
-                                          GetDATFileDataResult result) {
-  if (result.second.empty()) {
-    LOG(ERROR) << "Could not obtain ad block data";
-    return;
-  }
-  if (!result.first.get()) {
-    LOG(ERROR) << "Failed to deserialize ad block data";
+void AdBlockBaseService::OnGetDATFileData(
+    base::OnceClosure callback,
+    std::unique_ptr<adblock::Engine> engine) {
+  if (!engine) {
+    LOG(ERROR) << "Could not load ad block data";
     return;
   }
   GetTaskRunner()->PostTask(
       FROM_HERE, base::BindOnce(&AdBlockBaseService::UpdateAdBlockClient,
-                                base::Unretained(this),
-                                std::move(result.first)));
+                                base::Unretained(this), std::move(engine),
+                                false));
   // TODO(bridiver) this needs to happen after adblock client is actually reset
   std::move(callback).Run();
 }
 
+AdBlockBaseService::MergeableListData::MergeableListData() = default;
+AdBlockBaseService::MergeableListData::MergeableListData(
+    MergeableListData&& other) = default;
+AdBlockBaseService::MergeableListData::~MergeableListData() = default;
+
+// static
+AdBlockBaseService::MergeableListData AdBlockBaseService::LoadMergeableListData(
+    const base::FilePath& file_path,
+    bool deserialize) {
+  MergeableListData data;
+
+  // Precompiled components may ship the list text next to the DAT file, in
+  // which case the text is used so that the list can be merged.
+  base::FilePath text_path = file_path;
+  if (deserialize) {
+    text_path = file_path.DirName().Append(kAdBlockComponentListText);
+    if (!base::PathExists(text_path)) {
+      data.engine =
+          brave_component_updater::LoadMappedDATFileData<adblock::Engine>(
+              file_path);
+      return data;
+    }
+  }
+
+  // The text is dropped once the cosmetic rules are compiled. The merger reads
+  // it again from |text_path| whenever it rebuilds the combined engine.
+  const std::string rules =
+      brave_component_updater::GetDATFileAsString(text_path);
+  if (rules.empty())
+    return data;
+  data.engine = std::make_unique<adblock::Engine>(
+      std::vector<std::string>{rules}, /*include_network=*/false,
+      /*include_cosmetic=*/true);
+  data.rules_path = text_path;
+  return data;
+}
+
+void AdBlockBaseService::OnGetMergeableListData(base::OnceClosure callback,
+                                                MergeableListData data) {
+  if (!data.engine) {
+    LOG(ERROR) << "Could not load ad block data";
+    return;
+  }
+  if (data.rules_path.empty()) {
+    GetTaskRunner()->PostTask(
+        FROM_HERE, base::BindOnce(&AdBlockBaseService::UpdateAdBlockClient,
+                                  base::Unretained(this),
+                                  std::move(data.engine), false));
+  } else {
+    // The cosmetic-only engine would leave the list's network rules unmatched
+    // until the merger has them, so it replaces the current engine only then.
+    engine_merger_->SetRulesFile(
+        merger_source_id_, data.rules_path,
+        base::BindOnce(&AdBlockBaseService::UpdateAdBlockClient,
+                       base::Unretained(this), std::move(data.engine), true));
+  }
+  std::move(callback).Run();
+}
+
 void AdBlockBaseService::UpdateAdBlockClient(
-    std::unique_ptr<adblock::Engine> ad_block_client) {
+    std::unique_ptr<adblock::Engine> ad_block_client,
+    bool network_rules_merged) {
+  DCHECK(GetTaskRunner()->RunsTasksInCurrentSequence());
+  AddKnownTagsToAdBlockInstance(ad_block_client.get());
+  AddKnownResourcesToAdBlockInstance(ad_block_client.get());
+  // The flag is published along with the engine, so that a request never
+  // skips a list whose merged engine is not in use yet, or the reverse.
+  ad_block_client_.Publish(std::move(ad_block_client), network_rules_merged);
+  AdBlockDecisionCache::InvalidateAll();
+}
+
+void AdBlockBaseService::PostEngineChange(base::OnceClosure change) {
+  ++queued_engine_changes_;
+  GetTaskRunner()->PostTask(
+      FROM_HERE, base::BindOnce(&AdBlockBaseService::RunEngineChange,
+                                base::Unretained(this), std::move(change)));
+}
+
+void AdBlockBaseService::RunEngineChange(base::OnceClosure change) {
+  --queued_engine_changes_;
+  std::move(change).Run();
+}
+
+void AdBlockBaseService::MaybeRepublishAdBlockClient() {
   DCHECK(GetTaskRunner()->RunsTasksInCurrentSequence());
-  ad_block_client_ = std::move(ad_block_client);
-  AddKnownTagsToAdBlockInstance();
-  AddKnownResourcesToAdBlockInstance();
+  // Copying the engine serializes and deserializes all of its rules, so tags
+  // and resources that change together, as they do at startup, share the copy
+  // made by the last of them.
+  if (queued_engine_changes_ > 0)
+    return;
+
+  // The published engine may be in use on other threads, so tags and
+  // resources are changed on a copy.
+  const scoped_refptr<SharedAdBlockEngine> current = ad_block_client_.Get();
+  std::unique_ptr<adblock::Engine> engine = current->engine().clone();
+  if (!engine) {
+    LOG(ERROR) << "Could not copy ad block engine";
+    return;
+  }
+  AddKnownTagsToAdBlockInstance(engine.get());
+  for (const auto& tag : removed_tags_)
+    engine->removeTag(tag);
+  removed_tags_.clear();
+  AddKnownResourcesToAdBlockInstance(engine.get());
+  ad_block_client_.Publish(std::move(engine), current->network_rules_merged());
+  AdBlockDecisionCache::InvalidateAll();
+}
+
+void AdBlockBaseService::UpdateAdBlockClientFromRules(
+    const std::string& rules) {
+  DCHECK(GetTaskRunner()->RunsTasksInCurrentSequence());
+  if (!engine_merger_) {
+    ad_block_client_.Publish(std::make_unique<adblock::Engine>(rules));
+    AdBlockDecisionCache::InvalidateAll();
+    return;
+  }
+
+  engine_merger_->SetRules(
+      merger_source_id_, rules,
+      base::BindOnce(&AdBlockBaseService::UpdateAdBlockClient,
+                     base::Unretained(this),
+                     std::make_unique<adblock::Engine>(
+                         std::vector<std::string>{rules},
+                         /*include_network=*/false, /*include_cosmetic=*/true),
+                     true));
 }
 
-void AdBlockBaseService::AddKnownTagsToAdBlockInstance() {
+void AdBlockBaseService::AddKnownTagsToAdBlockInstance(
+    adblock::Engine* engine) {
   std::for_each(tags_.begin(), tags_.end(),
-                [&](const std::string tag) { ad_block_client_->addTag(tag); });
+                [&](const std::string tag) { engine->addTag(tag); });
 }
 
-void AdBlockBaseService::AddKnownResourcesToAdBlockInstance() {
-  ad_block_client_->addResources(resources_);
+void AdBlockBaseService::AddKnownResourcesToAdBlockInstance(
+    adblock::Engine* engine) {
+  engine->addResources(resources_);
 }
 
 bool AdBlockBaseService::Init() {
@@ -287,12 +356,14 @@ void AdBlockBaseService::ResetForTest(const std::string& rules,
   // This is temporary until adblock-rust supports incrementally adding
   // filter rules to an existing instance. At which point the hack below
   // will dissapear.
-  ad_block_client_.reset(new adblock::Engine(rules));
-  AddKnownTagsToAdBlockInstance();
+  auto engine = std::make_unique<adblock::Engine>(rules);
+  AddKnownTagsToAdBlockInstance(engine.get());
   if (!resources.empty()) {
     resources_ = resources;
   }
-  AddKnownResourcesToAdBlockInstance();
+  AddKnownResourcesToAdBlockInstance(engine.get());
+  ad_block_client_.Publish(std::move(engine));
+  AdBlockDecisionCache::InvalidateAll();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -8,6 +8,7 @@
 
 #include <stdint.h>
 
+#include <atomic>
 #include <memory>
 #include <set>
 #include <string>
@@ -17,9 +18,10 @@
 #include "base/files/file_path.h"
 #include "base/memory/weak_ptr.h"
 #include "base/sequence_checker.h"
-#include "base/values.h"
-#include "brave/components/brave_component_updater/browser/dat_file_util.h"
+#include "brave/components/brave_shields/browser/ad_block_engine_holder.h"
 #include "brave/components/brave_shields/browser/base_brave_shields_service.h"
+#include "brave/components/cosmetic_filters/common/cosmetic_filters.mojom.h"
+#include "third_party/abseil-cpp/absl/types/optional.h"
 #include "third_party/blink/public/mojom/loader/resource_load_info.mojom-shared.h"
 
 class AdBlockServiceTest;
@@ -33,13 +35,16 @@ class Engine;
 
 namespace brave_shields {
 
+class AdBlockEngineMerger;
+
 // The base class of the brave shields service in charge of ad-block
 // checking and init.
+//
+// ShouldStartRequest() and GetCspDirectives() only read the engine and may be
+// called on any thread, concurrently. Everything else runs on the task runner,
+// which is also where new engines are published.
 class AdBlockBaseService : public BaseBraveShieldsService {
  public:
-  using GetDATFileDataResult =
-      brave_component_updater::LoadDATFileDataResult<adblock::Engine>;
-
   explicit AdBlockBaseService(BraveComponent::Delegate* delegate);
   ~AdBlockBaseService() override;
 
@@ -59,9 +64,22 @@ class AdBlockBaseService : public BaseBraveShieldsService {
   void EnableTag(const std::string& tag, bool enabled);
   bool TagExists(const std::string& tag);
 
-  virtual absl::optional<base::Value> UrlCosmeticResources(
+  // Replaces |ad_block_client_| with an engine compiled from |rules|. If an
+  // engine merger is set, it gets the network rules and the engine is only
+  // replaced once the merger has published them.
+  void UpdateAdBlockClientFromRules(const std::string& rules);
+
+  // Compiles the network rules of this list into |merger|'s combined engine
+  // instead of matching them with |ad_block_client_|, which then only keeps
+  // the cosmetic rules. Only lists whose rule text is available can be merged;
+  // lists that only ship a precompiled DAT file keep matching on their own.
+  void SetEngineMerger(AdBlockEngineMerger* merger,
+                       const std::string& source_id);
+
+  virtual cosmetic_filters::mojom::CosmeticResourcesPtr UrlCosmeticResources(
       const std::string& url);
-  virtual absl::optional<base::Value> HiddenClassIdSelectors(
+  // Only the hide selectors of the result are set.
+  virtual cosmetic_filters::mojom::CosmeticResourcesPtr HiddenClassIdSelectors(
       const std::vector<std::string>& classes,
       const std::vector<std::string>& ids,
       const std::vector<std::string>& exceptions);
@@ -76,20 +94,51 @@ class AdBlockBaseService : public BaseBraveShieldsService {
   void GetDATFileData(const base::FilePath& dat_file_path,
                       bool deserialize = true,
                       base::OnceClosure callback = base::DoNothing());
-  void AddKnownTagsToAdBlockInstance();
-  void AddKnownResourcesToAdBlockInstance();
+  void AddKnownTagsToAdBlockInstance(adblock::Engine* engine);
+  void AddKnownResourcesToAdBlockInstance(adblock::Engine* engine);
   void ResetForTest(const std::string& rules, const std::string& resources);
 
-  std::unique_ptr<adblock::Engine> ad_block_client_;
+  AdBlockEngineHolder ad_block_client_;
 
  private:
-  void UpdateAdBlockClient(std::unique_ptr<adblock::Engine> ad_block_client);
+  // Result of loading a list that may be merged. |rules_path| is set when the
+  // rule text was available, in which case |engine| only holds cosmetic rules
+  // and the merger reads the network rules from |rules_path|.
+  struct MergeableListData {
+    MergeableListData();
+    MergeableListData(MergeableListData&& other);
+    ~MergeableListData();
+
+    std::unique_ptr<adblock::Engine> engine;
+    base::FilePath rules_path;
+  };
+
+  static MergeableListData LoadMergeableListData(
+      const base::FilePath& file_path,
+      bool deserialize);
+
+  void UpdateAdBlockClient(std::unique_ptr<adblock::Engine> ad_block_client,
+                           bool network_rules_merged);
+  // Runs |change| on the task runner, counting it as queued until then.
+  void PostEngineChange(base::OnceClosure change);
+  void RunEngineChange(base::OnceClosure change);
+  // Publishes a copy of the current engine with the known tags and resources
+  // applied, unless another change is queued and will do so.
+  void MaybeRepublishAdBlockClient();
   void OnGetDATFileData(base::OnceClosure callback,
-                        GetDATFileDataResult result);
+                        std::unique_ptr<adblock::Engine> engine);
+  void OnGetMergeableListData(base::OnceClosure callback,
+                              MergeableListData data);
   void OnPreferenceChanges(const std::string& pref_name);
 
   std::set<std::string> tags_;
+  // Tags that were disabled since the engine was last copied.
+  std::set<std::string> removed_tags_;
   std::string resources_;
+  // Tag and resource changes posted from the UI thread that have not run yet.
+  std::atomic<int> queued_engine_changes_{0};
+  AdBlockEngineMerger* engine_merger_ = nullptr;  // NOT OWNED
+  std::string merger_source_id_;
   base::WeakPtrFactory<AdBlockBaseService> weak_factory_;
   DISALLOW_COPY_AND_ASSIGN(AdBlockBaseService);
 };
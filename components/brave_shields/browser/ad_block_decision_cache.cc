@@ -0,0 +1,186 @@
+/* Copyright (c) 2021 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/components/brave_shields/browser/ad_block_decision_cache.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include "base/bits.h"
+#include "base/check.h"
+#include "base/containers/span.h"
+#include "base/hash/hash.h"
+#include "base/metrics/histogram.h"
+#include "url/gurl.h"
+
+namespace brave_shields {
+
+namespace {
+
+std::atomic<uint32_t>& Generation() {
+  static std::atomic<uint32_t> generation{1};
+  return generation;
+}
+
+uint8_t PackFlags(bool aggressive_blocking,
+                  const AdBlockDecisionCache::Decision& input) {
+  return (aggressive_blocking ? 1 : 0) | (input.did_match_rule ? 2 : 0) |
+         (input.did_match_exception ? 4 : 0) |
+         (input.did_match_important ? 8 : 0);
+}
+
+void RecordBooleans(const char* name,
+                    uint32_t true_count,
+                    uint32_t false_count) {
+  base::HistogramBase* histogram = base::BooleanHistogram::FactoryGet(
+      name, base::HistogramBase::kUmaTargetedHistogramFlag);
+  if (true_count)
+    histogram->AddCount(1, true_count);
+  if (false_count)
+    histogram->AddCount(0, false_count);
+}
+
+// |count| samples have been counted so far, and |true_count| of those not yet
+// recorded were true. Records them once a full batch is pending, or right
+// away if |flush| is set.
+void MaybeRecordBatch(const char* name,
+                      uint32_t count,
+                      std::atomic<uint32_t>* true_count,
+                      bool flush) {
+  const uint32_t pending = count % AdBlockDecisionCache::kHistogramBatchSize;
+  if (flush)
+    count = pending;
+  else if (pending == 0)
+    count = AdBlockDecisionCache::kHistogramBatchSize;
+  else
+    return;
+  if (count == 0)
+    return;
+  // Concurrent calls may already have counted towards the next batch, so the
+  // split is approximate.
+  const uint32_t trues = std::min(true_count->exchange(0), count);
+  RecordBooleans(name, trues, count - trues);
+}
+
+}  // namespace
+
+AdBlockDecisionCache::Shard::Shard() = default;
+
+AdBlockDecisionCache::Shard::~Shard() = default;
+
+AdBlockDecisionCache::AdBlockDecisionCache(size_t capacity)
+    : mask_(base::bits::RoundUpToPowerOfTwo(capacity) - 1),
+      shard_mask_(std::min(mask_ + 1, kShardCount) - 1),
+      shard_shift_(
+          base::bits::Log2Floor(static_cast<uint32_t>(shard_mask_ + 1))),
+      shards_(std::make_unique<Shard[]>(shard_mask_ + 1)) {
+  DCHECK_GT(capacity, 0u);
+  static_assert(base::bits::IsPowerOfTwo(kShardCount),
+                "kShardCount must be a power of two");
+  for (size_t i = 0; i <= shard_mask_; ++i) {
+    base::AutoLock lock(shards_[i].lock);
+    shards_[i].entries.resize((mask_ >> shard_shift_) + 1);
+  }
+}
+
+AdBlockDecisionCache::~AdBlockDecisionCache() {
+  MaybeRecordBatch("Brave.Adblock.DecisionCache.Hit", lookups_.load(), &hits_,
+                   /*flush=*/true);
+  MaybeRecordBatch("Brave.Adblock.DecisionCache.EvictedLiveEntry",
+                   inserts_.load(), &evicted_live_entries_, /*flush=*/true);
+}
+
+void AdBlockDecisionCache::RecordLookup(bool hit) {
+  if (hit)
+    hits_.fetch_add(1, std::memory_order_relaxed);
+  MaybeRecordBatch("Brave.Adblock.DecisionCache.Hit",
+                   lookups_.fetch_add(1, std::memory_order_relaxed) + 1,
+                   &hits_, /*flush=*/false);
+}
+
+void AdBlockDecisionCache::RecordInsert(bool evicted_live_entry) {
+  if (evicted_live_entry)
+    evicted_live_entries_.fetch_add(1, std::memory_order_relaxed);
+  MaybeRecordBatch("Brave.Adblock.DecisionCache.EvictedLiveEntry",
+                   inserts_.fetch_add(1, std::memory_order_relaxed) + 1,
+                   &evicted_live_entries_, /*flush=*/false);
+}
+
+size_t AdBlockDecisionCache::IndexFor(const GURL& url,
+                                      blink::mojom::ResourceType resource_type,
+                                      const std::string& tab_host,
+                                      uint8_t flags) const {
+  const uint32_t url_hash =
+      base::FastHash(base::as_bytes(base::make_span(url.spec())));
+  const uint32_t host_hash =
+      base::FastHash(base::as_bytes(base::make_span(tab_host)));
+  const size_t extra = (static_cast<size_t>(resource_type) << 4) | flags;
+  return base::HashInts(base::HashInts(url_hash, host_hash), extra) & mask_;
+}
+
+bool AdBlockDecisionCache::Lookup(const GURL& url,
+                                  blink::mojom::ResourceType resource_type,
+                                  const std::string& tab_host,
+                                  bool aggressive_blocking,
+                                  Decision* decision,
+                                  uint32_t* generation) {
+  DCHECK(decision);
+  DCHECK(generation);
+
+  const uint8_t flags = PackFlags(aggressive_blocking, *decision);
+  const size_t index = IndexFor(url, resource_type, tab_host, flags);
+  *generation = Generation().load();
+  Shard& shard = shards_[index & shard_mask_];
+  bool hit;
+  {
+    base::AutoLock lock(shard.lock);
+    const Entry& entry = shard.entries[index >> shard_shift_];
+    hit = entry.valid && entry.generation == *generation &&
+          entry.flags == flags && entry.resource_type == resource_type &&
+          entry.url_spec == url.spec() && entry.tab_host == tab_host;
+    if (hit)
+      *decision = entry.result;
+  }
+  RecordLookup(hit);
+  return hit;
+}
+
+void AdBlockDecisionCache::Insert(const GURL& url,
+                                  blink::mojom::ResourceType resource_type,
+                                  const std::string& tab_host,
+                                  bool aggressive_blocking,
+                                  uint32_t generation,
+                                  const Decision& input,
+                                  const Decision& result) {
+  const uint8_t flags = PackFlags(aggressive_blocking, input);
+  const size_t index = IndexFor(url, resource_type, tab_host, flags);
+  Shard& shard = shards_[index & shard_mask_];
+  bool evicted_live_entry;
+  {
+    base::AutoLock lock(shard.lock);
+    Entry& entry = shard.entries[index >> shard_shift_];
+    // Evicting an entry that is still current means the table is too small
+    // for the working set.
+    evicted_live_entry = entry.valid && entry.generation == generation;
+
+    // The entry is stamped with the generation seen by the preceding
+    // Lookup(), so it is stale already if an engine changed since.
+    entry.valid = true;
+    entry.generation = generation;
+    entry.flags = flags;
+    entry.resource_type = resource_type;
+    entry.url_spec = url.spec();
+    entry.tab_host = tab_host;
+    entry.result = result;
+  }
+  RecordInsert(evicted_live_entry);
+}
+
+// static
+void AdBlockDecisionCache::InvalidateAll() {
+  Generation().fetch_add(1);
+}
+
+}  // namespace brave_shields
@@ -0,0 +1,133 @@
+/* Copyright (c) 2021 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_AD_BLOCK_DECISION_CACHE_H_
+#define BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_AD_BLOCK_DECISION_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
+#include "third_party/blink/public/mojom/loader/resource_load_info.mojom-shared.h"
+
+class GURL;
+
+namespace brave_shields {
+
+// Memoizes network blocking decisions, so that sites fetching the same
+// tracker URL over and over (polling beacons, sprites, repeated XHRs) only pay
+// for the engine lookups once.
+//
+// Entries are keyed on the full request URL, the tab host, the resource type,
+// and the blocking inputs (aggressive mode and the incoming did_match_* flags).
+// The tab host is used rather than its eTLD+1 because $domain= options can
+// target subdomains. The table is direct-mapped and bounded, and every entry
+// stores its full key so a hash collision can never return a wrong decision.
+//
+// The cache may be used from several threads at once, since requests are
+// matched concurrently. The table is split into shards with a lock each, and a
+// lookup or insertion only holds the lock of its shard for the duration of a
+// few string comparisons. Reads are not lock-free, though: entries hold
+// strings, which cannot be copied safely while another thread rewrites them,
+// so the cache is behind the kBraveAdblockDecisionCache feature, off by
+// default, until its contention has been measured under concurrent matching.
+// InvalidateAll() may be called from any thread whenever an engine, tag,
+// resource set or list selection changes; stale entries are then treated as
+// misses without having to clear the table.
+//
+// Hit and eviction counts are reported to UMA in batches rather than on every
+// call.
+class AdBlockDecisionCache {
+ public:
+  struct Decision {
+    bool did_match_rule = false;
+    bool did_match_exception = false;
+    bool did_match_important = false;
+    // Only meaningful if |has_redirect| is set.
+    bool has_redirect = false;
+    std::string redirect;
+  };
+
+  explicit AdBlockDecisionCache(size_t capacity = kDefaultCapacity);
+  ~AdBlockDecisionCache();
+
+  // Returns true and fills |decision| if a current entry exists. |decision|
+  // carries the incoming did_match_* flags, which are part of the key. On a
+  // miss, the decision should be computed and passed to Insert() along with
+  // the |generation| returned here, so that a decision computed against
+  // engines that were replaced in the meantime is never treated as current.
+  bool Lookup(const GURL& url,
+              blink::mojom::ResourceType resource_type,
+              const std::string& tab_host,
+              bool aggressive_blocking,
+              Decision* decision,
+              uint32_t* generation);
+  void Insert(const GURL& url,
+              blink::mojom::ResourceType resource_type,
+              const std::string& tab_host,
+              bool aggressive_blocking,
+              uint32_t generation,
+              const Decision& input,
+              const Decision& result);
+
+  static void InvalidateAll();
+
+  static constexpr size_t kDefaultCapacity = 2048;
+  static constexpr size_t kShardCount = 16;
+  // Number of lookups, or insertions, per batch of UMA samples.
+  static constexpr uint32_t kHistogramBatchSize = 256;
+
+ private:
+  struct Entry {
+    uint32_t generation = 0;
+    bool valid = false;
+    uint8_t flags = 0;
+    blink::mojom::ResourceType resource_type;
+    std::string url_spec;
+    std::string tab_host;
+    Decision result;
+  };
+
+  struct Shard {
+    Shard();
+    ~Shard();
+
+    base::Lock lock;
+    std::vector<Entry> entries GUARDED_BY(lock);
+  };
+
+  size_t IndexFor(const GURL& url,
+                  blink::mojom::ResourceType resource_type,
+                  const std::string& tab_host,
+                  uint8_t flags) const;
+  void RecordLookup(bool hit);
+  void RecordInsert(bool evicted_live_entry);
+
+  // Entry |index| lives at |index >> shard_shift_| in shard
+  // |index & shard_mask_|.
+  const size_t mask_;
+  const size_t shard_mask_;
+  const size_t shard_shift_;
+  std::unique_ptr<Shard[]> shards_;
+
+  // Samples that have not been reported to UMA yet.
+  std::atomic<uint32_t> lookups_{0};
+  std::atomic<uint32_t> hits_{0};
+  std::atomic<uint32_t> inserts_{0};
+  std::atomic<uint32_t> evicted_live_entries_{0};
+
+  AdBlockDecisionCache(const AdBlockDecisionCache&) = delete;
+  AdBlockDecisionCache& operator=(const AdBlockDecisionCache&) = delete;
+};
+
+}  // namespace brave_shields
+
+#endif  // BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_AD_BLOCK_DECISION_CACHE_H_
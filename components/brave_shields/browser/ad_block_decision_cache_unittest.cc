@@ -0,0 +1,184 @@
+/* Copyright (c) 2021 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/components/brave_shields/browser/ad_block_decision_cache.h"
+
+#include <string>
+
+#include "base/test/metrics/histogram_tester.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "url/gurl.h"
+
+namespace brave_shields {
+
+namespace {
+
+constexpr char kTrackerSpec[] = "https://tracker.com/pixel.gif";
+constexpr blink::mojom::ResourceType kImage =
+    blink::mojom::ResourceType::kImage;
+
+AdBlockDecisionCache::Decision Blocked() {
+  AdBlockDecisionCache::Decision decision;
+  decision.did_match_rule = true;
+  return decision;
+}
+
+}  // namespace
+
+TEST(AdBlockDecisionCacheTest, ReturnsInsertedDecision) {
+  const GURL tracker_url(kTrackerSpec);
+  base::HistogramTester histogram_tester;
+  {
+    AdBlockDecisionCache cache;
+    AdBlockDecisionCache::Decision decision;
+    uint32_t generation;
+    EXPECT_FALSE(cache.Lookup(tracker_url, kImage, "example.com", false,
+                              &decision, &generation));
+    cache.Insert(tracker_url, kImage, "example.com", false, generation, {},
+                 Blocked());
+
+    decision = {};
+    ASSERT_TRUE(cache.Lookup(tracker_url, kImage, "example.com", false,
+                             &decision, &generation));
+    EXPECT_TRUE(decision.did_match_rule);
+    EXPECT_FALSE(decision.did_match_exception);
+  }
+  // Pending samples are recorded when the cache is destroyed.
+  histogram_tester.ExpectBucketCount("Brave.Adblock.DecisionCache.Hit", true,
+                                     1);
+  histogram_tester.ExpectBucketCount("Brave.Adblock.DecisionCache.Hit", false,
+                                     1);
+}
+
+TEST(AdBlockDecisionCacheTest, RecordsHistogramsInBatches) {
+  const GURL tracker_url(kTrackerSpec);
+  base::HistogramTester histogram_tester;
+  AdBlockDecisionCache cache;
+  AdBlockDecisionCache::Decision decision;
+  uint32_t generation;
+  cache.Lookup(tracker_url, kImage, "example.com", false, &decision,
+               &generation);
+  cache.Insert(tracker_url, kImage, "example.com", false, generation, {},
+               Blocked());
+  for (uint32_t i = 1; i < AdBlockDecisionCache::kHistogramBatchSize; ++i) {
+    histogram_tester.ExpectTotalCount("Brave.Adblock.DecisionCache.Hit", 0);
+    decision = {};
+    EXPECT_TRUE(cache.Lookup(tracker_url, kImage, "example.com", false,
+                             &decision, &generation));
+  }
+
+  histogram_tester.ExpectBucketCount("Brave.Adblock.DecisionCache.Hit", true,
+                                     AdBlockDecisionCache::kHistogramBatchSize -
+                                         1);
+  histogram_tester.ExpectBucketCount("Brave.Adblock.DecisionCache.Hit", false,
+                                     1);
+  histogram_tester.ExpectTotalCount(
+      "Brave.Adblock.DecisionCache.EvictedLiveEntry", 0);
+}
+
+TEST(AdBlockDecisionCacheTest, KeyIncludesContextAndInputs) {
+  const GURL tracker_url(kTrackerSpec);
+  AdBlockDecisionCache cache;
+  AdBlockDecisionCache::Decision decision;
+  uint32_t generation;
+  cache.Lookup(tracker_url, kImage, "example.com", false, &decision,
+               &generation);
+  cache.Insert(tracker_url, kImage, "example.com", false, generation, {},
+               Blocked());
+
+  decision = {};
+  EXPECT_FALSE(cache.Lookup(tracker_url, kImage, "www.example.com", false,
+                            &decision, &generation));
+  decision = {};
+  EXPECT_FALSE(cache.Lookup(tracker_url, blink::mojom::ResourceType::kScript,
+                            "example.com", false, &decision, &generation));
+  decision = {};
+  EXPECT_FALSE(cache.Lookup(tracker_url, kImage, "example.com", true,
+                            &decision, &generation));
+  decision = {};
+  decision.did_match_exception = true;
+  EXPECT_FALSE(cache.Lookup(tracker_url, kImage, "example.com", false,
+                            &decision, &generation));
+  decision = {};
+  EXPECT_FALSE(cache.Lookup(GURL("https://tracker.com/other.gif"), kImage,
+                            "example.com", false, &decision, &generation));
+}
+
+TEST(AdBlockDecisionCacheTest, InvalidateAllDropsEntries) {
+  const GURL tracker_url(kTrackerSpec);
+  AdBlockDecisionCache cache;
+  AdBlockDecisionCache::Decision decision;
+  uint32_t generation;
+  cache.Lookup(tracker_url, kImage, "example.com", false, &decision,
+               &generation);
+  cache.Insert(tracker_url, kImage, "example.com", false, generation, {},
+               Blocked());
+
+  AdBlockDecisionCache::InvalidateAll();
+  decision = {};
+  EXPECT_FALSE(cache.Lookup(tracker_url, kImage, "example.com", false,
+                            &decision, &generation));
+}
+
+TEST(AdBlockDecisionCacheTest, DecisionComputedAcrossInvalidationIsStale) {
+  const GURL tracker_url(kTrackerSpec);
+  AdBlockDecisionCache cache;
+  AdBlockDecisionCache::Decision decision;
+  uint32_t generation;
+  cache.Lookup(tracker_url, kImage, "example.com", false, &decision,
+               &generation);
+  // An engine changes while the decision is being computed.
+  AdBlockDecisionCache::InvalidateAll();
+  cache.Insert(tracker_url, kImage, "example.com", false, generation, {},
+               Blocked());
+
+  decision = {};
+  EXPECT_FALSE(cache.Lookup(tracker_url, kImage, "example.com", false,
+                            &decision, &generation));
+}
+
+TEST(AdBlockDecisionCacheTest, KeepsRedirects) {
+  const GURL tracker_url(kTrackerSpec);
+  AdBlockDecisionCache cache;
+  AdBlockDecisionCache::Decision result = Blocked();
+  result.has_redirect = true;
+  result.redirect = "data:text/javascript,";
+
+  AdBlockDecisionCache::Decision decision;
+  uint32_t generation;
+  cache.Lookup(tracker_url, kImage, "example.com", false, &decision,
+               &generation);
+  cache.Insert(tracker_url, kImage, "example.com", false, generation, {},
+               result);
+
+  decision = {};
+  ASSERT_TRUE(cache.Lookup(tracker_url, kImage, "example.com", false,
+                           &decision, &generation));
+  EXPECT_TRUE(decision.has_redirect);
+  EXPECT_EQ(decision.redirect, "data:text/javascript,");
+}
+
+TEST(AdBlockDecisionCacheTest, IsBounded) {
+  base::HistogramTester histogram_tester;
+  {
+    AdBlockDecisionCache cache(4);
+    AdBlockDecisionCache::Decision decision;
+    uint32_t generation;
+    for (int i = 0; i < 64; ++i) {
+      const GURL url("https://tracker.com/" + std::to_string(i));
+      cache.Lookup(url, kImage, "example.com", false, &decision, &generation);
+      cache.Insert(url, kImage, "example.com", false, generation, {},
+                   Blocked());
+    }
+  }
+  // At most one insertion per slot can land in an empty slot.
+  histogram_tester.ExpectTotalCount(
+      "Brave.Adblock.DecisionCache.EvictedLiveEntry", 64);
+  EXPECT_LE(histogram_tester.GetBucketCount(
+                "Brave.Adblock.DecisionCache.EvictedLiveEntry", false),
+            4);
+}
+
+}  // namespace brave_shields
@@ -0,0 +1,46 @@
+/* Copyright (c) 2021 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/components/brave_shields/browser/ad_block_engine_holder.h"
+
+#include <utility>
+
+#include "brave/components/adblock_rust_ffi/src/wrapper.h"
+
+namespace brave_shields {
+
+SharedAdBlockEngine::SharedAdBlockEngine(
+    std::unique_ptr<adblock::Engine> engine,
+    bool network_rules_merged)
+    : engine_(std::move(engine)), network_rules_merged_(network_rules_merged) {}
+
+SharedAdBlockEngine::~SharedAdBlockEngine() = default;
+
+AdBlockEngineHolder::AdBlockEngineHolder() = default;
+
+AdBlockEngineHolder::~AdBlockEngineHolder() = default;
+
+scoped_refptr<SharedAdBlockEngine> AdBlockEngineHolder::Get() const {
+  base::AutoLock lock(lock_);
+  return engine_;
+}
+
+void AdBlockEngineHolder::Publish(std::unique_ptr<adblock::Engine> engine,
+                                  bool network_rules_merged) {
+  scoped_refptr<SharedAdBlockEngine> shared_engine;
+  if (engine) {
+    shared_engine = base::MakeRefCounted<SharedAdBlockEngine>(
+        std::move(engine), network_rules_merged);
+  }
+
+  {
+    base::AutoLock lock(lock_);
+    engine_.swap(shared_engine);
+  }
+  // |shared_engine| now holds the previous engine. If no reader is using it,
+  // it is destroyed here, outside of the lock.
+}
+
+}  // namespace brave_shields
@@ -0,0 +1,75 @@
+/* Copyright (c) 2021 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_AD_BLOCK_ENGINE_HOLDER_H_
+#define BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_AD_BLOCK_ENGINE_HOLDER_H_
+
+#include <memory>
+
+#include "base/memory/ref_counted.h"
+#include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
+
+namespace adblock {
+class Engine;
+}  // namespace adblock
+
+namespace brave_shields {
+
+// An adblock::Engine that has been published to readers, along with how it is
+// to be used. It is never modified again and is destroyed once the last reader
+// drops its reference.
+class SharedAdBlockEngine
+    : public base::RefCountedThreadSafe<SharedAdBlockEngine> {
+ public:
+  SharedAdBlockEngine(std::unique_ptr<adblock::Engine> engine,
+                      bool network_rules_merged);
+
+  const adblock::Engine& engine() const { return *engine_; }
+  // Whether the network rules of the list are matched by a combined engine
+  // instead, in which case |engine| only holds its cosmetic rules.
+  bool network_rules_merged() const { return network_rules_merged_; }
+
+ private:
+  friend class base::RefCountedThreadSafe<SharedAdBlockEngine>;
+  ~SharedAdBlockEngine();
+
+  const std::unique_ptr<adblock::Engine> engine_;
+  const bool network_rules_merged_;
+
+  SharedAdBlockEngine(const SharedAdBlockEngine&) = delete;
+  SharedAdBlockEngine& operator=(const SharedAdBlockEngine&) = delete;
+};
+
+// Lets any number of threads match against an engine while it is being
+// replaced, read-copy-update style.
+//
+// Get() takes a reference to the current engine under a short lock, and
+// matching then runs without holding any lock. Writers never modify the
+// published engine: they build a new one, or clone() the current one and
+// change the copy, and Publish() it. Readers that are still using the previous
+// engine keep it alive until they are done.
+class AdBlockEngineHolder {
+ public:
+  AdBlockEngineHolder();
+  ~AdBlockEngineHolder();
+
+  // May be called on any thread. Returns null if no engine is published.
+  scoped_refptr<SharedAdBlockEngine> Get() const;
+  // Publishes |engine|, which may be null to withdraw the current engine.
+  void Publish(std::unique_ptr<adblock::Engine> engine,
+               bool network_rules_merged = false);
+
+ private:
+  mutable base::Lock lock_;
+  scoped_refptr<SharedAdBlockEngine> engine_ GUARDED_BY(lock_);
+
+  AdBlockEngineHolder(const AdBlockEngineHolder&) = delete;
+  AdBlockEngineHolder& operator=(const AdBlockEngineHolder&) = delete;
+};
+
+}  // namespace brave_shields
+
+#endif  // BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_AD_BLOCK_ENGINE_HOLDER_H_
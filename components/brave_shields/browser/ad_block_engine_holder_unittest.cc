@@ -0,0 +1,113 @@
+/* Copyright (c) 2021 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/components/brave_shields/browser/ad_block_engine_holder.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "base/bind.h"
+#include "base/task/thread_pool.h"
+#include "base/test/task_environment.h"
+#include "brave/components/adblock_rust_ffi/src/wrapper.h"
+#include "brave/components/brave_shields/browser/ad_block_test_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace brave_shields {
+
+namespace {
+
+bool ShouldBlock(const SharedAdBlockEngine& engine, const std::string& host) {
+  const std::string url = "https://" + host + "/t.js";
+  const std::string tab_host = "example.com";
+  bool did_match_rule = false;
+  bool did_match_exception = false;
+  bool did_match_important = false;
+  engine.engine().matches(url.data(), url.size(), host.data(), host.size(),
+                          tab_host.data(), tab_host.size(), true,
+                          adblock::ResourceType::kScript, &did_match_rule,
+                          &did_match_exception, &did_match_important, nullptr);
+  return did_match_important || (did_match_rule && !did_match_exception);
+}
+
+void MatchRepeatedly(AdBlockEngineHolder* holder,
+                     std::atomic<int>* blocked_count) {
+  for (int i = 0; i < 100; ++i) {
+    if (ShouldBlock(*holder->Get(), "tracker.com"))
+      ++*blocked_count;
+  }
+}
+
+}  // namespace
+
+class AdBlockEngineHolderTest : public testing::Test {
+ public:
+  AdBlockEngineHolderTest() {}
+  ~AdBlockEngineHolderTest() override {}
+
+  void SetUp() override { adblock::SetDomainResolver(TestDomainResolver); }
+
+ protected:
+  base::test::TaskEnvironment task_environment_;
+};
+
+TEST_F(AdBlockEngineHolderTest, EmptyUntilPublished) {
+  AdBlockEngineHolder holder;
+  EXPECT_FALSE(holder.Get());
+
+  holder.Publish(std::make_unique<adblock::Engine>("||tracker.com^"));
+  ASSERT_TRUE(holder.Get());
+  EXPECT_TRUE(ShouldBlock(*holder.Get(), "tracker.com"));
+
+  holder.Publish(nullptr);
+  EXPECT_FALSE(holder.Get());
+}
+
+TEST_F(AdBlockEngineHolderTest, ReadersKeepReplacedEngine) {
+  AdBlockEngineHolder holder;
+  holder.Publish(std::make_unique<adblock::Engine>("||tracker.com^"));
+  const scoped_refptr<SharedAdBlockEngine> previous = holder.Get();
+
+  holder.Publish(std::make_unique<adblock::Engine>("||other-tracker.com^"));
+  EXPECT_TRUE(ShouldBlock(*previous, "tracker.com"));
+  EXPECT_FALSE(ShouldBlock(*holder.Get(), "tracker.com"));
+  EXPECT_TRUE(ShouldBlock(*holder.Get(), "other-tracker.com"));
+}
+
+TEST_F(AdBlockEngineHolderTest, NetworkRulesMergedIsPublishedWithEngine) {
+  AdBlockEngineHolder holder;
+  holder.Publish(std::make_unique<adblock::Engine>("||tracker.com^"));
+  const scoped_refptr<SharedAdBlockEngine> previous = holder.Get();
+  EXPECT_FALSE(previous->network_rules_merged());
+
+  holder.Publish(std::make_unique<adblock::Engine>(),
+                 /*network_rules_merged=*/true);
+  EXPECT_FALSE(previous->network_rules_merged());
+  EXPECT_TRUE(holder.Get()->network_rules_merged());
+}
+
+TEST_F(AdBlockEngineHolderTest, ConcurrentReadersDuringPublish) {
+  constexpr int kReaders = 8;
+  AdBlockEngineHolder holder;
+  holder.Publish(std::make_unique<adblock::Engine>("||tracker.com^"));
+
+  std::atomic<int> blocked_count{0};
+  for (int i = 0; i < kReaders; ++i) {
+    base::ThreadPool::PostTask(
+        FROM_HERE, base::BindOnce(&MatchRepeatedly, base::Unretained(&holder),
+                                  base::Unretained(&blocked_count)));
+  }
+  // Every engine published meanwhile blocks the tracker too.
+  for (int i = 0; i < 10; ++i) {
+    holder.Publish(
+        std::make_unique<adblock::Engine>("||tracker.com^\n||ads.com^"));
+  }
+  task_environment_.RunUntilIdle();
+
+  EXPECT_EQ(blocked_count, kReaders * 100);
+}
+
+}  // namespace brave_shields
@@ -0,0 +1,338 @@
+/* Copyright (c) 2021 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/components/brave_shields/browser/ad_block_engine_merger.h"
+
+#include <utility>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/files/file_path.h"
+#include "base/logging.h"
+#include "base/strings/string_piece.h"
+#include "base/task/thread_pool.h"
+#include "brave/components/adblock_rust_ffi/src/wrapper.h"
+#include "brave/components/brave_component_updater/browser/dat_file_util.h"
+#include "brave/components/brave_shields/browser/ad_block_decision_cache.h"
+#include "brave/components/brave_shields/browser/ad_block_service_helper.h"
+#include "url/gurl.h"
+
+namespace brave_shields {
+
+namespace {
+
+std::unique_ptr<adblock::Engine> BuildCombinedEngine(
+    std::vector<std::string> rule_lists,
+    std::vector<base::FilePath> rule_paths) {
+  for (const auto& rules_path : rule_paths) {
+    std::string rules =
+        brave_component_updater::GetDATFileAsString(rules_path);
+    // The list is matched without these rules until it is loaded again.
+    if (rules.empty()) {
+      LOG(ERROR) << "Could not read ad block rules from "
+                 << rules_path.value();
+      continue;
+    }
+    rule_lists.push_back(std::move(rules));
+  }
+  return std::make_unique<adblock::Engine>(rule_lists,
+                                           /*include_network=*/true,
+                                           /*include_cosmetic=*/false);
+}
+
+}  // namespace
+
+AdBlockEngineMerger::Source::Source() = default;
+AdBlockEngineMerger::Source::Source(Source&& other) = default;
+AdBlockEngineMerger::Source& AdBlockEngineMerger::Source::operator=(
+    Source&& other) = default;
+AdBlockEngineMerger::Source::~Source() = default;
+
+AdBlockEngineMerger::AdBlockEngineMerger(
+    scoped_refptr<base::SequencedTaskRunner> task_runner)
+    : task_runner_(task_runner) {}
+
+AdBlockEngineMerger::~AdBlockEngineMerger() {
+  DCHECK(task_runner_->RunsTasksInCurrentSequence());
+}
+
+void AdBlockEngineMerger::SetRules(const std::string& source_id,
+                                   const std::string& rules,
+                                   base::OnceClosure merged_callback) {
+  SetSource(source_id, rules, base::FilePath(), std::move(merged_callback));
+}
+
+void AdBlockEngineMerger::SetRulesFile(const std::string& source_id,
+                                       const base::FilePath& rules_path,
+                                       base::OnceClosure merged_callback) {
+  SetSource(source_id, std::string(), rules_path, std::move(merged_callback));
+}
+
+void AdBlockEngineMerger::SetSource(const std::string& source_id,
+                                    std::string rules,
+                                    base::FilePath rules_path,
+                                    base::OnceClosure merged_callback) {
+  if (!task_runner_->RunsTasksInCurrentSequence()) {
+    task_runner_->PostTask(
+        FROM_HERE,
+        base::BindOnce(&AdBlockEngineMerger::SetSource,
+                       weak_factory_.GetWeakPtr(), source_id, std::move(rules),
+                       std::move(rules_path), std::move(merged_callback)));
+    return;
+  }
+
+  Source& source = sources_[source_id];
+  source.rules = std::move(rules);
+  source.rules_path = std::move(rules_path);
+  if (disabled_sources_.find(source_id) == disabled_sources_.end())
+    ScheduleRebuild();
+  // Added after the rebuild is scheduled, so that only an engine built from
+  // these rules runs the callback.
+  if (merged_callback) {
+    base::AutoLock lock(merged_callbacks_lock_);
+    merged_callbacks_[source_id].emplace_back(generation_,
+                                              std::move(merged_callback));
+  }
+}
+
+void AdBlockEngineMerger::SetSourceEnabled(const std::string& source_id,
+                                           bool enabled) {
+  if (!task_runner_->RunsTasksInCurrentSequence()) {
+    task_runner_->PostTask(
+        FROM_HERE,
+        base::BindOnce(&AdBlockEngineMerger::SetSourceEnabled,
+                       weak_factory_.GetWeakPtr(), source_id, enabled));
+    return;
+  }
+
+  const bool changed = enabled ? disabled_sources_.erase(source_id) > 0
+                               : disabled_sources_.insert(source_id).second;
+  if (changed && sources_.find(source_id) != sources_.end())
+    ScheduleRebuild();
+}
+
+void AdBlockEngineMerger::RemoveRules(const std::string& source_id) {
+  // Dropped right away rather than with the source, since a build that
+  // contains the rules may land before the posted removal runs. This is done
+  // again on |task_runner_| for callbacks of a SetRules() call that was still
+  // queued.
+  {
+    base::AutoLock lock(merged_callbacks_lock_);
+    merged_callbacks_.erase(source_id);
+  }
+
+  if (!task_runner_->RunsTasksInCurrentSequence()) {
+    task_runner_->PostTask(
+        FROM_HERE, base::BindOnce(&AdBlockEngineMerger::RemoveRules,
+                                  weak_factory_.GetWeakPtr(), source_id));
+    return;
+  }
+
+  disabled_sources_.erase(source_id);
+  if (sources_.erase(source_id) > 0)
+    ScheduleRebuild();
+}
+
+void AdBlockEngineMerger::EnableTag(const std::string& tag, bool enabled) {
+  if (!task_runner_->RunsTasksInCurrentSequence()) {
+    PostEngineChange(base::BindOnce(&AdBlockEngineMerger::EnableTag,
+                                    weak_factory_.GetWeakPtr(), tag, enabled));
+    return;
+  }
+
+  if (enabled) {
+    if (!tags_.insert(tag).second)
+      return;
+    removed_tags_.erase(tag);
+  } else {
+    if (tags_.erase(tag) == 0)
+      return;
+    removed_tags_.insert(tag);
+  }
+  MaybeRepublishEngine();
+}
+
+void AdBlockEngineMerger::AddResources(const std::string& resources) {
+  if (!task_runner_->RunsTasksInCurrentSequence()) {
+    PostEngineChange(base::BindOnce(&AdBlockEngineMerger::AddResources,
+                                    weak_factory_.GetWeakPtr(), resources));
+    return;
+  }
+
+  resources_ = resources;
+  MaybeRepublishEngine();
+}
+
+void AdBlockEngineMerger::ShouldStartRequest(
+    const GURL& url,
+    blink::mojom::ResourceType resource_type,
+    const std::string& tab_host,
+    bool* did_match_rule,
+    bool* did_match_exception,
+    bool* did_match_important,
+    std::string* mock_data_url) {
+  const scoped_refptr<SharedAdBlockEngine> engine = engine_.Get();
+  if (!engine)
+    return;
+
+  const std::string& spec = url.spec();
+  const base::StringPiece host = url.host_piece();
+  engine->engine().matches(
+      spec.data(), spec.size(), host.data(), host.size(), tab_host.data(),
+      tab_host.size(), IsThirdPartyRequest(url, tab_host),
+      ResourceTypeToEngineType(resource_type), did_match_rule,
+      did_match_exception, did_match_important, mock_data_url);
+}
+
+absl::optional<std::string> AdBlockEngineMerger::GetCspDirectives(
+    const GURL& url,
+    blink::mojom::ResourceType resource_type,
+    const std::string& tab_host) {
+  const scoped_refptr<SharedAdBlockEngine> engine = engine_.Get();
+  if (!engine)
+    return absl::nullopt;
+
+  const std::string& spec = url.spec();
+  const base::StringPiece host = url.host_piece();
+  const std::string result = engine->engine().getCspDirectives(
+      spec.data(), spec.size(), host.data(), host.size(), tab_host.data(),
+      tab_host.size(), IsThirdPartyRequest(url, tab_host),
+      ResourceTypeToEngineType(resource_type));
+  if (result.empty())
+    return absl::nullopt;
+  return result;
+}
+
+void AdBlockEngineMerger::ScheduleRebuild() {
+  DCHECK(task_runner_->RunsTasksInCurrentSequence());
+  ++generation_;
+  // Changes that arrive while a build is running are picked up by a single
+  // follow-up build once it lands, so a burst of list loads at startup only
+  // compiles the combined engine a couple of times.
+  if (!build_in_progress_)
+    StartBuild();
+}
+
+void AdBlockEngineMerger::StartBuild() {
+  DCHECK(task_runner_->RunsTasksInCurrentSequence());
+  std::vector<std::string> source_ids;
+  std::vector<std::string> rule_lists;
+  std::vector<base::FilePath> rule_paths;
+  for (const auto& source : sources_) {
+    if (disabled_sources_.find(source.first) != disabled_sources_.end())
+      continue;
+    source_ids.push_back(source.first);
+    if (source.second.rules_path.empty())
+      rule_lists.push_back(source.second.rules);
+    else
+      rule_paths.push_back(source.second.rules_path);
+  }
+
+  if (source_ids.empty()) {
+    engine_.Publish(nullptr);
+    AdBlockDecisionCache::InvalidateAll();
+    return;
+  }
+
+  build_in_progress_ = true;
+  base::ThreadPool::PostTaskAndReplyWithResult(
+      FROM_HERE, {base::MayBlock(), base::TaskPriority::USER_VISIBLE},
+      base::BindOnce(&BuildCombinedEngine, std::move(rule_lists),
+                     std::move(rule_paths)),
+      base::BindOnce(&AdBlockEngineMerger::OnCombinedEngineBuilt,
+                     weak_factory_.GetWeakPtr(), generation_,
+                     std::move(source_ids)));
+}
+
+void AdBlockEngineMerger::OnCombinedEngineBuilt(
+    uint64_t generation,
+    std::vector<std::string> source_ids,
+    std::unique_ptr<adblock::Engine> engine) {
+  DCHECK(task_runner_->RunsTasksInCurrentSequence());
+  build_in_progress_ = false;
+
+  // Even a stale engine is a better approximation of the enabled lists than
+  // the previous one, so swap it in while the follow-up build runs.
+  for (const auto& tag : tags_)
+    engine->addTag(tag);
+  removed_tags_.clear();
+  if (!resources_.empty())
+    engine->addResources(resources_);
+  engine_.Publish(std::move(engine));
+  AdBlockDecisionCache::InvalidateAll();
+  RunMergedCallbacks(generation, source_ids);
+
+  if (generation != generation_)
+    StartBuild();
+}
+
+void AdBlockEngineMerger::RunMergedCallbacks(
+    uint64_t generation,
+    const std::vector<std::string>& source_ids) {
+  DCHECK(task_runner_->RunsTasksInCurrentSequence());
+  // The lock is held while the callbacks run, so that RemoveRules() does not
+  // return while the callback of the removed source is running.
+  base::AutoLock lock(merged_callbacks_lock_);
+  std::vector<base::OnceClosure> callbacks;
+  for (const auto& source_id : source_ids) {
+    auto merged_callbacks = merged_callbacks_.find(source_id);
+    if (merged_callbacks == merged_callbacks_.end())
+      continue;
+    MergedCallbacks& pending = merged_callbacks->second;
+    auto end = pending.begin();
+    while (end != pending.end() && end->first <= generation) {
+      callbacks.push_back(std::move(end->second));
+      ++end;
+    }
+    pending.erase(pending.begin(), end);
+    if (pending.empty())
+      merged_callbacks_.erase(merged_callbacks);
+  }
+  for (auto& callback : callbacks)
+    std::move(callback).Run();
+}
+
+void AdBlockEngineMerger::PostEngineChange(base::OnceClosure change) {
+  ++queued_engine_changes_;
+  task_runner_->PostTask(
+      FROM_HERE, base::BindOnce(&AdBlockEngineMerger::RunEngineChange,
+                                weak_factory_.GetWeakPtr(), std::move(change)));
+}
+
+void AdBlockEngineMerger::RunEngineChange(base::OnceClosure change) {
+  --queued_engine_changes_;
+  std::move(change).Run();
+}
+
+void AdBlockEngineMerger::MaybeRepublishEngine() {
+  DCHECK(task_runner_->RunsTasksInCurrentSequence());
+  // Copying the engine serializes and deserializes all of its rules, so a
+  // burst of tag and resource changes shares the copy made by the last one.
+  if (queued_engine_changes_ > 0)
+    return;
+
+  const scoped_refptr<SharedAdBlockEngine> current = engine_.Get();
+  if (!current)
+    return;
+
+  // The published engine may be in use on other threads, so changes are made
+  // to a copy.
+  std::unique_ptr<adblock::Engine> engine = current->engine().clone();
+  if (!engine) {
+    LOG(ERROR) << "Could not copy the combined ad block engine";
+    return;
+  }
+  for (const auto& tag : tags_)
+    engine->addTag(tag);
+  for (const auto& tag : removed_tags_)
+    engine->removeTag(tag);
+  removed_tags_.clear();
+  if (!resources_.empty())
+    engine->addResources(resources_);
+  engine_.Publish(std::move(engine));
+  AdBlockDecisionCache::InvalidateAll();
+}
+
+}  // namespace brave_shields
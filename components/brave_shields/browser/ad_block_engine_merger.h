@@ -0,0 +1,152 @@
+/* Copyright (c) 2021 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_AD_BLOCK_ENGINE_MERGER_H_
+#define BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_AD_BLOCK_ENGINE_MERGER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/callback.h"
+#include "base/files/file_path.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/memory/weak_ptr.h"
+#include "base/sequenced_task_runner.h"
+#include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
+#include "brave/components/brave_shields/browser/ad_block_engine_holder.h"
+#include "third_party/abseil-cpp/absl/types/optional.h"
+#include "third_party/blink/public/mojom/loader/resource_load_info.mojom-shared.h"
+
+class GURL;
+
+namespace adblock {
+class Engine;
+}  // namespace adblock
+
+namespace brave_shields {
+
+// Compiles the network rules of several filter lists into one combined
+// adblock::Engine, so that a request is matched with a single lookup instead
+// of one lookup per list.
+//
+// Rules are kept per source (a list uuid, subscription URL, etc.) so that a
+// single list can be replaced, disabled or removed without touching the
+// others. Lists that live on disk are only referenced by path and are read
+// again for each rebuild, so their text is not kept in memory. Any change
+// schedules a rebuild on a background sequence, and the new engine is
+// published on |task_runner_|. Requests are matched against the published
+// engine, on any thread.
+//
+// Exceptions and $important rules are resolved across all lists, exactly as
+// when each list is checked in turn with the shared did_match_* flags.
+class AdBlockEngineMerger {
+ public:
+  explicit AdBlockEngineMerger(
+      scoped_refptr<base::SequencedTaskRunner> task_runner);
+  ~AdBlockEngineMerger();
+
+  // These may be called from any sequence. |merged_callback| is run on
+  // |task_runner_| once an engine that contains the rules has been published.
+  // It is dropped by the time RemoveRules() returns for the source, so it may
+  // be bound to an object that is destroyed right after that. It must not call
+  // into the merger.
+  void SetRules(const std::string& source_id,
+                const std::string& rules,
+                base::OnceClosure merged_callback = base::OnceClosure());
+  void SetRulesFile(const std::string& source_id,
+                    const base::FilePath& rules_path,
+                    base::OnceClosure merged_callback = base::OnceClosure());
+  void SetSourceEnabled(const std::string& source_id, bool enabled);
+  void RemoveRules(const std::string& source_id);
+  void EnableTag(const std::string& tag, bool enabled);
+  void AddResources(const std::string& resources);
+
+  // These may be called on any thread, concurrently, and follow the same
+  // contract as their AdBlockBaseService counterparts. They are no-ops until
+  // the first combined engine has been built.
+  void ShouldStartRequest(const GURL& url,
+                          blink::mojom::ResourceType resource_type,
+                          const std::string& tab_host,
+                          bool* did_match_rule,
+                          bool* did_match_exception,
+                          bool* did_match_important,
+                          std::string* mock_data_url);
+  absl::optional<std::string> GetCspDirectives(
+      const GURL& url,
+      blink::mojom::ResourceType resource_type,
+      const std::string& tab_host);
+
+ private:
+  // The rules of a list, either as text or as the path of a text file.
+  struct Source {
+    Source();
+    Source(Source&& other);
+    Source& operator=(Source&& other);
+    ~Source();
+
+    std::string rules;
+    base::FilePath rules_path;
+  };
+
+  // Merged callbacks with the generation at which they were added.
+  using MergedCallbacks = std::vector<std::pair<uint64_t, base::OnceClosure>>;
+
+  void SetSource(const std::string& source_id,
+                 std::string rules,
+                 base::FilePath rules_path,
+                 base::OnceClosure merged_callback);
+  void ScheduleRebuild();
+  void StartBuild();
+  void OnCombinedEngineBuilt(uint64_t generation,
+                             std::vector<std::string> source_ids,
+                             std::unique_ptr<adblock::Engine> engine);
+  // Runs the callbacks of |source_ids| that were added up to |generation|.
+  void RunMergedCallbacks(uint64_t generation,
+                          const std::vector<std::string>& source_ids);
+  // Runs |change| on |task_runner_|, counting it as queued until then.
+  void PostEngineChange(base::OnceClosure change);
+  void RunEngineChange(base::OnceClosure change);
+  // Publishes a copy of the current engine with |tags_| and |resources_|
+  // applied, unless another change is queued and will do so.
+  void MaybeRepublishEngine();
+
+  scoped_refptr<base::SequencedTaskRunner> task_runner_;
+
+  std::map<std::string, Source> sources_;
+  std::set<std::string> disabled_sources_;
+  std::set<std::string> tags_;
+  // Tags that were disabled since the engine was last built or copied.
+  std::set<std::string> removed_tags_;
+  std::string resources_;
+  // Tag and resource changes posted from other sequences that have not run
+  // yet.
+  std::atomic<int> queued_engine_changes_{0};
+
+  // Only RemoveRules() touches this off |task_runner_|.
+  base::Lock merged_callbacks_lock_;
+  std::map<std::string, MergedCallbacks> merged_callbacks_
+      GUARDED_BY(merged_callbacks_lock_);
+
+  AdBlockEngineHolder engine_;
+  uint64_t generation_ = 0;
+  bool build_in_progress_ = false;
+
+  base::WeakPtrFactory<AdBlockEngineMerger> weak_factory_{this};
+
+  AdBlockEngineMerger(const AdBlockEngineMerger&) = delete;
+  AdBlockEngineMerger& operator=(const AdBlockEngineMerger&) = delete;
+};
+
+}  // namespace brave_shields
+
+#endif  // BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_AD_BLOCK_ENGINE_MERGER_H_
@@ -0,0 +1,175 @@
+/* Copyright (c) 2021 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/components/brave_shields/browser/ad_block_engine_merger.h"
+
+#include <memory>
+#include <string>
+
+#include "base/bind.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/task/thread_pool.h"
+#include "base/task/thread_pool/thread_pool_instance.h"
+#include "base/test/task_environment.h"
+#include "base/threading/sequenced_task_runner_handle.h"
+#include "brave/components/adblock_rust_ffi/src/wrapper.h"
+#include "brave/components/brave_shields/browser/ad_block_test_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "url/gurl.h"
+
+namespace brave_shields {
+
+class AdBlockEngineMergerTest : public testing::Test {
+ public:
+  AdBlockEngineMergerTest() {}
+  ~AdBlockEngineMergerTest() override {}
+
+  void SetUp() override {
+    adblock::SetDomainResolver(TestDomainResolver);
+    merger_ = std::make_unique<AdBlockEngineMerger>(
+        base::SequencedTaskRunnerHandle::Get());
+  }
+
+  void TearDown() override {
+    merger_.reset();
+    task_environment_.RunUntilIdle();
+  }
+
+  bool ShouldBlock(const std::string& url) {
+    bool did_match_rule = false;
+    bool did_match_exception = false;
+    bool did_match_important = false;
+    std::string mock_data_url;
+    merger_->ShouldStartRequest(GURL(url), blink::mojom::ResourceType::kScript,
+                                "example.com", &did_match_rule,
+                                &did_match_exception, &did_match_important,
+                                &mock_data_url);
+    return did_match_important || (did_match_rule && !did_match_exception);
+  }
+
+ protected:
+  base::test::TaskEnvironment task_environment_;
+  std::unique_ptr<AdBlockEngineMerger> merger_;
+};
+
+TEST_F(AdBlockEngineMergerTest, MatchesRulesFromAllLists) {
+  merger_->SetRules("a", "||tracker-a.com^");
+  merger_->SetRules("b", "||tracker-b.com^");
+  task_environment_.RunUntilIdle();
+
+  EXPECT_TRUE(ShouldBlock("https://tracker-a.com/t.js"));
+  EXPECT_TRUE(ShouldBlock("https://tracker-b.com/t.js"));
+  EXPECT_FALSE(ShouldBlock("https://other.com/t.js"));
+}
+
+TEST_F(AdBlockEngineMergerTest, ExceptionsAndImportantApplyAcrossLists) {
+  merger_->SetRules("a", "||tracker-a.com^\n||tracker-b.com^");
+  merger_->SetRules("b", "@@||tracker-a.com/ok.js");
+  merger_->SetRules("c", "||tracker-b.com^$important\n@@||tracker-b.com^");
+  task_environment_.RunUntilIdle();
+
+  EXPECT_FALSE(ShouldBlock("https://tracker-a.com/ok.js"));
+  EXPECT_TRUE(ShouldBlock("https://tracker-a.com/t.js"));
+  EXPECT_TRUE(ShouldBlock("https://tracker-b.com/t.js"));
+}
+
+TEST_F(AdBlockEngineMergerTest, DisabledAndRemovedListsStopMatching) {
+  merger_->SetRules("a", "||tracker-a.com^");
+  merger_->SetRules("b", "||tracker-b.com^");
+  task_environment_.RunUntilIdle();
+
+  merger_->SetSourceEnabled("a", false);
+  merger_->RemoveRules("b");
+  task_environment_.RunUntilIdle();
+  EXPECT_FALSE(ShouldBlock("https://tracker-a.com/t.js"));
+  EXPECT_FALSE(ShouldBlock("https://tracker-b.com/t.js"));
+
+  merger_->SetSourceEnabled("a", true);
+  task_environment_.RunUntilIdle();
+  EXPECT_TRUE(ShouldBlock("https://tracker-a.com/t.js"));
+}
+
+TEST_F(AdBlockEngineMergerTest, MergedCallbackRunsOnceRulesArePublished) {
+  bool merged = false;
+  merger_->SetRules("a", "||tracker-a.com^",
+                    base::BindOnce(
+                        [](AdBlockEngineMergerTest* test, bool* merged) {
+                          EXPECT_TRUE(
+                              test->ShouldBlock("https://tracker-a.com/t.js"));
+                          *merged = true;
+                        },
+                        this, &merged));
+  EXPECT_FALSE(merged);
+  task_environment_.RunUntilIdle();
+  EXPECT_TRUE(merged);
+
+  // Disabled lists are not merged until they are enabled again.
+  merged = false;
+  merger_->SetSourceEnabled("b", false);
+  merger_->SetRules("b", "||tracker-b.com^",
+                    base::BindOnce([](bool* merged) { *merged = true; },
+                                   &merged));
+  task_environment_.RunUntilIdle();
+  EXPECT_FALSE(merged);
+
+  merger_->SetSourceEnabled("b", true);
+  task_environment_.RunUntilIdle();
+  EXPECT_TRUE(merged);
+}
+
+TEST_F(AdBlockEngineMergerTest, RemovedListDropsPendingMergedCallback) {
+  bool merged = false;
+  merger_->SetRules("a", "||tracker-a.com^",
+                    base::BindOnce([](bool* merged) { *merged = true; },
+                                   &merged));
+  // Lets the build finish, so that its engine is queued for publishing ahead
+  // of the removal below.
+  base::ThreadPoolInstance::Get()->FlushForTesting();
+
+  // Disabling a list removes its rules from the UI thread and then destroys
+  // the service that the callback is bound to.
+  base::ThreadPool::PostTask(
+      FROM_HERE, base::BindOnce(&AdBlockEngineMerger::RemoveRules,
+                                base::Unretained(merger_.get()),
+                                std::string("a")));
+  base::ThreadPoolInstance::Get()->FlushForTesting();
+  task_environment_.RunUntilIdle();
+
+  EXPECT_FALSE(merged);
+  EXPECT_FALSE(ShouldBlock("https://tracker-a.com/t.js"));
+}
+
+TEST_F(AdBlockEngineMergerTest, RulesFilesAreReadOnEachBuild) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  const base::FilePath rules_path = temp_dir.GetPath().AppendASCII("list.txt");
+  ASSERT_TRUE(base::WriteFile(rules_path, "||tracker-a.com^"));
+
+  merger_->SetRulesFile("a", rules_path);
+  task_environment_.RunUntilIdle();
+  EXPECT_TRUE(ShouldBlock("https://tracker-a.com/t.js"));
+
+  // Changing another list rebuilds the combined engine from the file.
+  ASSERT_TRUE(base::WriteFile(rules_path, "||tracker-b.com^"));
+  merger_->SetRules("c", "||tracker-c.com^");
+  task_environment_.RunUntilIdle();
+  EXPECT_FALSE(ShouldBlock("https://tracker-a.com/t.js"));
+  EXPECT_TRUE(ShouldBlock("https://tracker-b.com/t.js"));
+  EXPECT_TRUE(ShouldBlock("https://tracker-c.com/t.js"));
+}
+
+TEST_F(AdBlockEngineMergerTest, UpdatedListReplacesPreviousRules) {
+  merger_->SetRules("a", "||tracker-a.com^");
+  task_environment_.RunUntilIdle();
+  EXPECT_TRUE(ShouldBlock("https://tracker-a.com/t.js"));
+
+  merger_->SetRules("a", "||tracker-b.com^");
+  task_environment_.RunUntilIdle();
+  EXPECT_FALSE(ShouldBlock("https://tracker-a.com/t.js"));
+  EXPECT_TRUE(ShouldBlock("https://tracker-b.com/t.js"));
+}
+
+}  // namespace brave_shields
@@ -0,0 +1,176 @@
+/* Copyright (c) 2021 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/strings/string_piece.h"
+#include "base/timer/elapsed_timer.h"
+#include "brave/components/adblock_rust_ffi/src/wrapper.h"
+#include "brave/components/brave_shields/browser/ad_block_service_helper.h"
+#include "brave/components/brave_shields/browser/ad_block_test_util.h"
+#include "brave/test/base/scoped_allocation_counter.h"
+#include "net/base/registry_controlled_domains/registry_controlled_domain.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+#include "url/gurl.h"
+#include "url/origin.h"
+
+namespace brave_shields {
+
+namespace {
+
+constexpr int kIterations = 20000;
+
+constexpr char kRules[] =
+    "||tracker.com^\n"
+    "||ads.example.net^$third-party\n"
+    "/pixel.gif$image\n"
+    "@@||tracker.com/allowed.js$script\n"
+    "||cdn.example.org/ads/*$script,domain=example.com\n";
+
+constexpr const char* kRequestUrls[] = {
+    "https://tracker.com/pixel.gif",
+    "https://tracker.com/allowed.js",
+    "https://ads.example.net/banner.png?id=1234567890",
+    "https://cdn.example.org/ads/loader.js",
+    "https://cdn.example.org/lib/jquery.min.js",
+    "https://www.example.com/static/app.js",
+};
+
+// The string-based path as AdBlockBaseService used it before the slice API.
+void MatchWithStrings(adblock::Engine* engine,
+                      const GURL& url,
+                      const std::string& tab_host,
+                      bool* did_match_rule) {
+  bool did_match_exception = false;
+  bool did_match_important = false;
+  std::string redirect;
+  const bool is_third_party =
+      !net::registry_controlled_domains::SameDomainOrHost(
+          url, url::Origin::CreateFromNormalizedTuple("https", tab_host, 80),
+          net::registry_controlled_domains::INCLUDE_PRIVATE_REGISTRIES);
+  engine->matches(url.spec(), url.host(), tab_host, is_third_party, "script",
+                  did_match_rule, &did_match_exception, &did_match_important,
+                  &redirect);
+}
+
+void MatchWithSlices(adblock::Engine* engine,
+                     const GURL& url,
+                     const std::string& tab_host,
+                     bool* did_match_rule) {
+  bool did_match_exception = false;
+  bool did_match_important = false;
+  std::string redirect;
+  const std::string& spec = url.spec();
+  const base::StringPiece host = url.host_piece();
+  engine->matches(spec.data(), spec.size(), host.data(), host.size(),
+                  tab_host.data(), tab_host.size(),
+                  IsThirdPartyRequest(url, tab_host),
+                  adblock::ResourceType::kScript, did_match_rule,
+                  &did_match_exception, &did_match_important, &redirect);
+}
+
+}  // namespace
+
+class AdBlockMatchingPerfTest : public testing::Test {
+ public:
+  AdBlockMatchingPerfTest() {}
+  ~AdBlockMatchingPerfTest() override {}
+
+  void SetUp() override {
+    adblock::SetDomainResolver(TestDomainResolver);
+    engine_ = std::make_unique<adblock::Engine>(kRules);
+    for (const char* spec : kRequestUrls)
+      urls_.emplace_back(spec);
+  }
+
+ protected:
+  template <typename MatchFunction>
+  void RunMatches(const std::string& story, MatchFunction match) {
+    const std::string tab_host = "www.example.com";
+    int matched = 0;
+    base::ElapsedTimer timer;
+    for (int i = 0; i < kIterations; ++i) {
+      for (const GURL& url : urls_) {
+        bool did_match_rule = false;
+        match(engine_.get(), url, tab_host, &did_match_rule);
+        matched += did_match_rule;
+      }
+    }
+    const base::TimeDelta elapsed = timer.Elapsed();
+    // Keeps the loop from being optimized away.
+    EXPECT_GT(matched, 0);
+
+    perf_test::PerfResultReporter reporter("AdBlockMatching", story);
+    reporter.RegisterImportantMetric(".lookup", "ns");
+    reporter.AddResult(".lookup",
+                       elapsed.InNanoseconds() /
+                           static_cast<double>(kIterations * urls_.size()));
+
+    if (ScopedAllocationCounter::IsSupported()) {
+      // Includes the allocations made by adblock-rust itself.
+      uint64_t allocation_count = 0;
+      {
+        ScopedAllocationCounter allocation_counter;
+        for (const GURL& url : urls_) {
+          bool did_match_rule = false;
+          match(engine_.get(), url, tab_host, &did_match_rule);
+        }
+        allocation_count = allocation_counter.count();
+      }
+      reporter.RegisterImportantMetric(".allocations", "count");
+      reporter.AddResult(".allocations",
+                         allocation_count / static_cast<double>(urls_.size()));
+    }
+  }
+
+  std::unique_ptr<adblock::Engine> engine_;
+  std::vector<GURL> urls_;
+};
+
+TEST_F(AdBlockMatchingPerfTest, StringArguments) {
+  RunMatches("strings", &MatchWithStrings);
+}
+
+TEST_F(AdBlockMatchingPerfTest, SliceArguments) {
+  RunMatches("slices", &MatchWithSlices);
+}
+
+// adblock-rust allocates while matching, but preparing its arguments must not.
+// Besides the third-party check, they are all views into the request's GURL.
+TEST_F(AdBlockMatchingPerfTest, SliceArgumentsDoNotAllocate) {
+  if (!ScopedAllocationCounter::IsSupported())
+    return;
+
+  const std::string tab_host = "www.example.com";
+  int third_party = 0;
+  uint64_t allocation_count = 0;
+  {
+    ScopedAllocationCounter allocation_counter;
+    for (const GURL& url : urls_)
+      third_party += IsThirdPartyRequest(url, tab_host);
+    allocation_count = allocation_counter.count();
+  }
+
+  EXPECT_GT(third_party, 0);
+  EXPECT_EQ(0u, allocation_count);
+}
+
+TEST_F(AdBlockMatchingPerfTest, SlicesMatchStrings) {
+  const std::string tab_host = "www.example.com";
+  for (const GURL& url : urls_) {
+    bool string_result = false;
+    bool slice_result = false;
+    MatchWithStrings(engine_.get(), url, tab_host, &string_result);
+    MatchWithSlices(engine_.get(), url, tab_host, &slice_result);
+    EXPECT_EQ(string_result, slice_result) << url.spec();
+  }
+}
+
+}  // namespace brave_shields
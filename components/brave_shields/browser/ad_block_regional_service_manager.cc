@@ -13,6 +13,8 @@
 #include "base/task/post_task.h"
 #include "base/values.h"
 #include "brave/components/adblock_rust_ffi/src/wrapper.h"
+#include "brave/components/brave_shields/browser/ad_block_decision_cache.h"
+#include "brave/components/brave_shields/browser/ad_block_engine_merger.h"
 #include "brave/components/brave_shields/browser/ad_block_regional_service.h"
 #include "brave/components/brave_shields/browser/ad_block_service.h"
 #include "brave/components/brave_shields/browser/ad_block_service_helper.h"
@@ -74,13 +76,8 @@ void AdBlockRegionalServiceManager::StartRegionalServices() {
       auto catalog_entry = brave_shields::FindAdBlockFilterListByUUID(
           regional_catalog_, uuid);
       if (catalog_entry != regional_catalog_.end()) {
-        auto regional_service = AdBlockRegionalServiceFactory(
-            *catalog_entry, delegate_,
-            base::BindRepeating(&AdBlockRegionalServiceManager::AddResources,
-                                base::Unretained(this)));
-        regional_service->Start();
         regional_services_.insert(
-            std::make_pair(uuid, std::move(regional_service)));
+            std::make_pair(uuid, StartRegionalService(*catalog_entry)));
       }
     }
   }
@@ -88,6 +85,32 @@ void AdBlockRegionalServiceManager::StartRegionalServices() {
   initialized_ = true;
 }
 
+std::unique_ptr<AdBlockRegionalService>
+AdBlockRegionalServiceManager::StartRegionalService(
+    const FilterList& catalog_entry) {
+  auto regional_service = AdBlockRegionalServiceFactory(
+      catalog_entry, delegate_,
+      base::BindRepeating(&AdBlockRegionalServiceManager::AddResources,
+                          base::Unretained(this)));
+  if (engine_merger_)
+    regional_service->SetEngineMerger(engine_merger_, catalog_entry.uuid);
+  regional_service->Start();
+  return regional_service;
+}
+
+AdBlockRegionalService*
+AdBlockRegionalServiceManager::StartRegionalServiceForTesting(
+    const std::string& uuid) {
+  auto catalog_entry =
+      brave_shields::FindAdBlockFilterListByUUID(regional_catalog_, uuid);
+  DCHECK(catalog_entry != regional_catalog_.end());
+  base::AutoLock lock(regional_services_lock_);
+  auto it = regional_services_.insert(
+      std::make_pair(uuid, StartRegionalService(*catalog_entry)));
+  initialized_ = true;
+  return it.first->second.get();
+}
+
 void AdBlockRegionalServiceManager::UpdateFilterListPrefs(
     const std::string& uuid,
     bool enabled) {
@@ -102,6 +125,11 @@ void AdBlockRegionalServiceManager::UpdateFilterListPrefs(
   regional_filters_dict->Set(uuid, std::move(regional_filter_dict));
 }
 
+void AdBlockRegionalServiceManager::SetEngineMerger(
+    AdBlockEngineMerger* engine_merger) {
+  engine_merger_ = engine_merger;
+}
+
 bool AdBlockRegionalServiceManager::IsInitialized() const {
   return initialized_;
 }
@@ -145,6 +173,7 @@ absl::optional<std::string> AdBlockRegionalServiceManager::GetCspDirectives(
     const std::string& tab_host) {
   absl::optional<std::string> csp_directives = absl::nullopt;
 
+  base::AutoLock lock(regional_services_lock_);
   for (const auto& regional_service : regional_services_) {
     const auto directive =
         regional_service.second->GetCspDirectives(url, resource_type, tab_host);
@@ -183,17 +212,17 @@ void AdBlockRegionalServiceManager::EnableFilterList(
     auto it = regional_services_.find(uuid);
     if (enabled) {
       DCHECK(it == regional_services_.end());
-      auto regional_service = AdBlockRegionalServiceFactory(
-          *catalog_entry, delegate_,
-          base::BindRepeating(&AdBlockRegionalServiceManager::AddResources,
-                              base::Unretained(this)));
-      regional_service->Start();
       regional_services_.insert(
-          std::make_pair(uuid, std::move(regional_service)));
+          std::make_pair(uuid, StartRegionalService(*catalog_entry)));
     } else {
       DCHECK(it != regional_services_.end());
+      // Removed first, so that no merged callback runs on the destroyed
+      // service.
+      if (engine_merger_)
+        engine_merger_->RemoveRules(uuid);
       it->second->Unregister();
       regional_services_.erase(it);
+      AdBlockDecisionCache::InvalidateAll();
     }
   }
 
@@ -205,23 +234,15 @@ void AdBlockRegionalServiceManager::EnableFilterList(
                      base::Unretained(this), uuid, enabled));
 }
 
-absl::optional<base::Value> AdBlockRegionalServiceManager::UrlCosmeticResources(
-    const std::string& url) {
+cosmetic_filters::mojom::CosmeticResourcesPtr
+AdBlockRegionalServiceManager::UrlCosmeticResources(const std::string& url) {
   base::AutoLock lock(regional_services_lock_);
-  auto it = regional_services_.begin();
-  if (it == regional_services_.end()) {
-    return absl::optional<base::Value>();
-  }
-  absl::optional<base::Value> first_value =
-      it->second->UrlCosmeticResources(url);
-
-  for ( ; it != regional_services_.end(); it++) {
-    absl::optional<base::Value> next_value =
-        it->second->UrlCosmeticResources(url);
+  cosmetic_filters::mojom::CosmeticResourcesPtr first_value;
+  for (const auto& regional_service : regional_services_) {
+    cosmetic_filters::mojom::CosmeticResourcesPtr next_value =
+        regional_service.second->UrlCosmeticResources(url);
     if (first_value) {
-      if (next_value) {
-        MergeResourcesInto(std::move(*next_value), &*first_value, false);
-      }
+      MergeResourcesInto(std::move(next_value), first_value.get(), false);
     } else {
       first_value = std::move(next_value);
     }
@@ -230,30 +251,20 @@ absl::optional<base::Value> AdBlockRegionalServiceManager::UrlCosmeticResources(
   return first_value;
 }
 
-absl::optional<base::Value>
+cosmetic_filters::mojom::CosmeticResourcesPtr
 AdBlockRegionalServiceManager::HiddenClassIdSelectors(
     const std::vector<std::string>& classes,
     const std::vector<std::string>& ids,
     const std::vector<std::string>& exceptions) {
   base::AutoLock lock(regional_services_lock_);
-  auto it = regional_services_.begin();
-  if (it == regional_services_.end()) {
-    return absl::optional<base::Value>();
-  }
-  absl::optional<base::Value> first_value =
-      it->second->HiddenClassIdSelectors(classes, ids, exceptions);
-
-  for ( ; it != regional_services_.end(); it++) {
-    absl::optional<base::Value> next_value =
-        it->second->HiddenClassIdSelectors(classes, ids, exceptions);
-    if (first_value && first_value->is_list()) {
-      if (next_value && next_value->is_list()) {
-        for (auto i = next_value->GetList().begin();
-                i < next_value->GetList().end();
-                i++) {
-          first_value->Append(std::move(*i));
-        }
-      }
+  cosmetic_filters::mojom::CosmeticResourcesPtr first_value;
+  for (const auto& regional_service : regional_services_) {
+    cosmetic_filters::mojom::CosmeticResourcesPtr next_value =
+        regional_service.second->HiddenClassIdSelectors(classes, ids,
+                                                         exceptions);
+    if (first_value) {
+      AppendSelectorsInto(std::move(next_value->hide_selectors),
+                          &first_value->hide_selectors);
     } else {
       first_value = std::move(next_value);
     }
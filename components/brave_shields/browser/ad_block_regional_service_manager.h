@@ -17,6 +17,7 @@
 #include "base/values.h"
 #include "brave/components/adblock_rust_ffi/src/wrapper.h"
 #include "brave/components/brave_component_updater/browser/brave_component.h"
+#include "brave/components/cosmetic_filters/common/cosmetic_filters.mojom.h"
 #include "third_party/abseil-cpp/absl/types/optional.h"
 #include "third_party/blink/public/mojom/loader/resource_load_info.mojom-shared.h"
 #include "url/gurl.h"
@@ -31,6 +32,7 @@ using brave_component_updater::BraveComponent;
 
 namespace brave_shields {
 
+class AdBlockEngineMerger;
 class AdBlockRegionalService;
 
 // The AdBlock regional service manager, in charge of initializing and
@@ -45,6 +47,11 @@ class AdBlockRegionalServiceManager {
   void SetRegionalCatalog(std::vector<adblock::FilterList> catalog);
   const std::vector<adblock::FilterList>& GetRegionalCatalog();
 
+  // Makes regional lists contribute their network rules to |engine_merger|'s
+  // combined engine when their rule text is available. Must be called before
+  // the regional catalog is set.
+  void SetEngineMerger(AdBlockEngineMerger* engine_merger);
+
   bool IsInitialized() const;
   bool Start();
   void ShouldStartRequest(const GURL& url,
@@ -63,18 +70,27 @@ class AdBlockRegionalServiceManager {
   void AddResources(const std::string& resources);
   void EnableFilterList(const std::string& uuid, bool enabled);
 
-  absl::optional<base::Value> UrlCosmeticResources(const std::string& url);
-  absl::optional<base::Value> HiddenClassIdSelectors(
+  cosmetic_filters::mojom::CosmeticResourcesPtr UrlCosmeticResources(
+      const std::string& url);
+  cosmetic_filters::mojom::CosmeticResourcesPtr HiddenClassIdSelectors(
       const std::vector<std::string>& classes,
       const std::vector<std::string>& ids,
       const std::vector<std::string>& exceptions);
 
+  // Starts the service of the catalog list |uuid| without going through
+  // prefs, which need local state, and returns it.
+  AdBlockRegionalService* StartRegionalServiceForTesting(
+      const std::string& uuid);
+
  private:
   friend class ::AdBlockServiceTest;
   void StartRegionalServices();
+  std::unique_ptr<AdBlockRegionalService> StartRegionalService(
+      const adblock::FilterList& catalog_entry);
   void UpdateFilterListPrefs(const std::string& uuid, bool enabled);
 
   brave_component_updater::BraveComponent::Delegate* delegate_;  // NOT OWNED
+  AdBlockEngineMerger* engine_merger_ = nullptr;                  // NOT OWNED
   bool initialized_;
   base::Lock regional_services_lock_;
   std::map<std::string, std::unique_ptr<AdBlockRegionalService>>
@@ -17,9 +17,13 @@
 #include "base/memory/ptr_util.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/utf_string_conversions.h"
+#include "base/task/thread_pool.h"
 #include "base/threading/thread_restrictions.h"
 #include "brave/components/adblock_rust_ffi/src/wrapper.h"
+#include "brave/components/brave_component_updater/browser/dat_file_util.h"
 #include "brave/components/brave_shields/browser/ad_block_custom_filters_service.h"
+#include "brave/components/brave_shields/browser/ad_block_decision_cache.h"
+#include "brave/components/brave_shields/browser/ad_block_engine_merger.h"
 #include "brave/components/brave_shields/browser/ad_block_regional_service_manager.h"
 #include "brave/components/brave_shields/browser/ad_block_service_helper.h"
 #include "brave/components/brave_shields/browser/ad_block_subscription_service_manager.h"
@@ -31,7 +35,7 @@
 #include "components/prefs/pref_service.h"
 #include "net/base/registry_controlled_domains/registry_controlled_domain.h"
 #include "third_party/abseil-cpp/absl/types/optional.h"
-#include "url/origin.h"
+#include "url/gurl.h"
 
 #define DAT_FILE "rs-ABPFilterParserData.dat"
 #define REGIONAL_CATALOG "regional_catalog.json"
@@ -76,12 +80,49 @@ void AdBlockService::ShouldStartRequest(
   if (!IsInitialized())
     return;
 
+  if (!decision_cache_ || !did_match_rule || !did_match_exception ||
+      !did_match_important) {
+    MatchRequest(url, resource_type, tab_host, aggressive_blocking,
+                 did_match_rule, did_match_exception, did_match_important,
+                 mock_data_url);
+    return;
+  }
+
+  AdBlockDecisionCache::Decision decision;
+  decision.did_match_rule = *did_match_rule;
+  decision.did_match_exception = *did_match_exception;
+  decision.did_match_important = *did_match_important;
+  uint32_t generation;
+  if (!decision_cache_->Lookup(url, resource_type, tab_host,
+                               aggressive_blocking, &decision, &generation)) {
+    const AdBlockDecisionCache::Decision input = decision;
+    MatchRequest(url, resource_type, tab_host, aggressive_blocking,
+                 &decision.did_match_rule, &decision.did_match_exception,
+                 &decision.did_match_important, &decision.redirect);
+    decision.has_redirect = !decision.redirect.empty();
+    decision_cache_->Insert(url, resource_type, tab_host, aggressive_blocking,
+                            generation, input, decision);
+  }
+
+  *did_match_rule = decision.did_match_rule;
+  *did_match_exception = decision.did_match_exception;
+  *did_match_important = decision.did_match_important;
+  if (decision.has_redirect && mock_data_url)
+    *mock_data_url = decision.redirect;
+}
+
+void AdBlockService::MatchRequest(const GURL& url,
+                                  blink::mojom::ResourceType resource_type,
+                                  const std::string& tab_host,
+                                  bool aggressive_blocking,
+                                  bool* did_match_rule,
+                                  bool* did_match_exception,
+                                  bool* did_match_important,
+                                  std::string* mock_data_url) {
   if (aggressive_blocking ||
       base::FeatureList::IsEnabled(
           brave_shields::features::kBraveAdblockDefault1pBlocking) ||
-      !SameDomainOrHost(
-          url, url::Origin::CreateFromNormalizedTuple("https", tab_host, 80),
-          net::registry_controlled_domains::INCLUDE_PRIVATE_REGISTRIES)) {
+      IsThirdPartyRequest(url, tab_host)) {
     AdBlockBaseService::ShouldStartRequest(
         url, resource_type, tab_host, aggressive_blocking, did_match_rule,
         did_match_exception, did_match_important, mock_data_url);
@@ -90,6 +131,15 @@ void AdBlockService::ShouldStartRequest(
     }
   }
 
+  if (engine_merger_) {
+    engine_merger_->ShouldStartRequest(url, resource_type, tab_host,
+                                       did_match_rule, did_match_exception,
+                                       did_match_important, mock_data_url);
+    if (did_match_important && *did_match_important) {
+      return;
+    }
+  }
+
   regional_service_manager()->ShouldStartRequest(
       url, resource_type, tab_host, aggressive_blocking, did_match_rule,
       did_match_exception, did_match_important, mock_data_url);
@@ -116,6 +166,12 @@ absl::optional<std::string> AdBlockService::GetCspDirectives(
   auto csp_directives =
       AdBlockBaseService::GetCspDirectives(url, resource_type, tab_host);
 
+  if (engine_merger_) {
+    const auto merged_csp =
+        engine_merger_->GetCspDirectives(url, resource_type, tab_host);
+    MergeCspDirectiveInto(merged_csp, &csp_directives);
+  }
+
   const auto regional_csp = regional_service_manager()->GetCspDirectives(
       url, resource_type, tab_host);
   MergeCspDirectiveInto(regional_csp, &csp_directives);
@@ -127,120 +183,74 @@ absl::optional<std::string> AdBlockService::GetCspDirectives(
   return csp_directives;
 }
 
-absl::optional<base::Value> AdBlockService::UrlCosmeticResources(
-    const std::string& url) {
-  absl::optional<base::Value> resources =
+cosmetic_filters::mojom::CosmeticResourcesPtr
+AdBlockService::UrlCosmeticResources(const std::string& url) {
+  cosmetic_filters::mojom::CosmeticResourcesPtr resources =
       AdBlockBaseService::UrlCosmeticResources(url);
 
-  if (!resources || !resources->is_dict()) {
-    return resources;
-  }
-
-  absl::optional<base::Value> regional_resources =
+  cosmetic_filters::mojom::CosmeticResourcesPtr regional_resources =
       regional_service_manager()->UrlCosmeticResources(url);
 
-  if (regional_resources && regional_resources->is_dict()) {
-    MergeResourcesInto(std::move(*regional_resources), &*resources,
+  if (regional_resources) {
+    MergeResourcesInto(std::move(regional_resources), resources.get(),
                        /*force_hide=*/false);
   }
 
-  absl::optional<base::Value> custom_resources =
-      custom_filters_service()->UrlCosmeticResources(url);
+  MergeResourcesInto(custom_filters_service()->UrlCosmeticResources(url),
+                     resources.get(), /*force_hide=*/true);
 
-  if (custom_resources && custom_resources->is_dict()) {
-    MergeResourcesInto(std::move(*custom_resources), &*resources,
-                       /*force_hide=*/true);
-  }
-
-  absl::optional<base::Value> subscription_resources =
+  cosmetic_filters::mojom::CosmeticResourcesPtr subscription_resources =
       subscription_service_manager()->UrlCosmeticResources(url);
 
-  if (subscription_resources && subscription_resources->is_dict()) {
-    MergeResourcesInto(std::move(*subscription_resources), &*resources,
+  if (subscription_resources) {
+    MergeResourcesInto(std::move(subscription_resources), resources.get(),
                        /*force_hide=*/true);
   }
 
   return resources;
 }
 
-absl::optional<base::Value> AdBlockService::HiddenClassIdSelectors(
+cosmetic_filters::mojom::CosmeticResourcesPtr
+AdBlockService::HiddenClassIdSelectors(
     const std::vector<std::string>& classes,
     const std::vector<std::string>& ids,
     const std::vector<std::string>& exceptions) {
-  absl::optional<base::Value> hide_selectors =
+  cosmetic_filters::mojom::CosmeticResourcesPtr resources =
       AdBlockBaseService::HiddenClassIdSelectors(classes, ids, exceptions);
 
-  absl::optional<base::Value> regional_selectors =
+  cosmetic_filters::mojom::CosmeticResourcesPtr regional_selectors =
       regional_service_manager()->HiddenClassIdSelectors(classes, ids,
                                                          exceptions);
 
-  if (hide_selectors && hide_selectors->is_list()) {
-    if (regional_selectors && regional_selectors->is_list()) {
-      for (auto i = regional_selectors->GetList().begin();
-           i < regional_selectors->GetList().end(); i++) {
-        hide_selectors->Append(std::move(*i));
-      }
-    }
-  } else {
-    hide_selectors = std::move(regional_selectors);
+  if (regional_selectors) {
+    AppendSelectorsInto(std::move(regional_selectors->hide_selectors),
+                        &resources->hide_selectors);
   }
 
-  absl::optional<base::Value> custom_selectors =
-      custom_filters_service()->HiddenClassIdSelectors(classes, ids,
-                                                       exceptions);
+  AppendSelectorsInto(
+      std::move(custom_filters_service()
+                    ->HiddenClassIdSelectors(classes, ids, exceptions)
+                    ->hide_selectors),
+      &resources->force_hide_selectors);
 
-  absl::optional<base::Value> subscription_selectors =
+  cosmetic_filters::mojom::CosmeticResourcesPtr subscription_selectors =
       subscription_service_manager()->HiddenClassIdSelectors(classes, ids,
                                                              exceptions);
 
-  if (custom_selectors && custom_selectors->is_list()) {
-    if (subscription_selectors && subscription_selectors->is_list()) {
-      for (auto i = subscription_selectors->GetList().begin();
-           i < subscription_selectors->GetList().end(); i++) {
-        custom_selectors->Append(std::move(*i));
-      }
-    }
-  } else {
-    custom_selectors = std::move(subscription_selectors);
+  if (subscription_selectors) {
+    AppendSelectorsInto(std::move(subscription_selectors->hide_selectors),
+                        &resources->force_hide_selectors);
   }
 
-#if !defined(OS_ANDROID) && !defined(CHROME_OS)
-  if (!base::FeatureList::IsEnabled(
-          brave_shields::features::kBraveAdblockCosmeticFilteringNative)) {
-    auto result_list = std::make_unique<base::ListValue>();
-    if (hide_selectors && hide_selectors->is_list()) {
-      result_list->Append(std::move(*hide_selectors));
-    }
-    if (custom_selectors && custom_selectors->is_list()) {
-      result_list->Append(std::move(*custom_selectors));
-    }
-
-    return std::move(*result_list);
-  }
-#endif
-
-  if (!hide_selectors || !hide_selectors->is_list())
-    hide_selectors = base::ListValue();
-
-  if (custom_selectors && custom_selectors->is_list())
-    hide_selectors->Append(std::move(*custom_selectors));
-
-  return hide_selectors;
+  return resources;
 }
 
 AdBlockRegionalServiceManager* AdBlockService::regional_service_manager() {
-  if (!regional_service_manager_)
-    regional_service_manager_ =
-        brave_shields::AdBlockRegionalServiceManagerFactory(
-            component_delegate_);
   return regional_service_manager_.get();
 }
 
 brave_shields::AdBlockCustomFiltersService*
 AdBlockService::custom_filters_service() {
-  if (!custom_filters_service_)
-    custom_filters_service_ =
-        brave_shields::AdBlockCustomFiltersServiceFactory(component_delegate_);
   return custom_filters_service_.get();
 }
 
@@ -249,15 +259,62 @@ AdBlockService::subscription_service_manager() {
   return subscription_service_manager_.get();
 }
 
+scoped_refptr<base::TaskRunner> AdBlockService::GetMatchingTaskRunner() {
+  return matching_task_runner_;
+}
+
+AdBlockEngineMerger* AdBlockService::engine_merger() {
+  return engine_merger_.get();
+}
+
 AdBlockService::AdBlockService(
     brave_component_updater::BraveComponent::Delegate* delegate,
     std::unique_ptr<AdBlockSubscriptionServiceManager>
         subscription_service_manager)
     : AdBlockBaseService(delegate),
       component_delegate_(delegate),
-      subscription_service_manager_(std::move(subscription_service_manager)) {}
+      subscription_service_manager_(std::move(subscription_service_manager)) {
+  if (base::FeatureList::IsEnabled(
+          brave_shields::features::kBraveAdblockMergedEngine)) {
+    engine_merger_ = std::make_unique<AdBlockEngineMerger>(GetTaskRunner());
+    // The default list can only join the combined engine when it applies to
+    // first-party requests too, like every other list.
+    if (base::FeatureList::IsEnabled(
+            brave_shields::features::kBraveAdblockDefault1pBlocking)) {
+      SetEngineMerger(engine_merger_.get(), "default");
+    }
+    subscription_service_manager_->SetEngineMerger(engine_merger_.get());
+  }
+  // Created here rather than on first use, since requests may be matched on
+  // any thread before the component is ready.
+  regional_service_manager_ =
+      brave_shields::AdBlockRegionalServiceManagerFactory(component_delegate_);
+  regional_service_manager_->SetEngineMerger(engine_merger_.get());
+  custom_filters_service_ =
+      brave_shields::AdBlockCustomFiltersServiceFactory(component_delegate_);
+  if (engine_merger_)
+    custom_filters_service_->SetEngineMerger(engine_merger_.get(), "custom");
+  if (base::FeatureList::IsEnabled(
+          brave_shields::features::kBraveAdblockDecisionCache)) {
+    decision_cache_ = std::make_unique<AdBlockDecisionCache>();
+  }
+  // Matching only reads the engines, see AdBlockEngineHolder.
+  if (base::FeatureList::IsEnabled(
+          brave_shields::features::kBraveAdblockConcurrentMatching)) {
+    matching_task_runner_ = base::ThreadPool::CreateTaskRunner(
+        {base::TaskPriority::USER_BLOCKING,
+         base::TaskShutdownBehavior::SKIP_ON_SHUTDOWN});
+  } else {
+    matching_task_runner_ = GetTaskRunner();
+  }
+}
 
-AdBlockService::~AdBlockService() {}
+AdBlockService::~AdBlockService() {
+  if (engine_merger_)
+    GetTaskRunner()->DeleteSoon(FROM_HERE, engine_merger_.release());
+  if (decision_cache_)
+    GetTaskRunner()->DeleteSoon(FROM_HERE, decision_cache_.release());
+}
 
 bool AdBlockService::Init() {
   // Initializes adblock-rust's domain resolution implementation
@@ -303,6 +360,8 @@ void AdBlockService::OnComponentReady(const std::string& component_id,
 void AdBlockService::OnResourcesFileDataReady(const std::string& resources) {
   AddResources(resources);
   custom_filters_service()->AddResources(resources);
+  if (engine_merger_)
+    engine_merger_->AddResources(resources);
 }
 
 void AdBlockService::OnRegionalCatalogFileDataReady(
@@ -12,6 +12,8 @@
 #include <string>
 #include <vector>
 
+#include "base/memory/scoped_refptr.h"
+#include "base/task_runner.h"
 #include "base/values.h"
 #include "brave/components/brave_shields/browser/ad_block_base_service.h"
 #include "components/keyed_service/core/keyed_service.h"
@@ -28,6 +30,8 @@ using brave_component_updater::BraveComponent;
 
 namespace brave_shields {
 
+class AdBlockDecisionCache;
+class AdBlockEngineMerger;
 class AdBlockRegionalServiceManager;
 class AdBlockCustomFiltersService;
 class AdBlockSubscriptionServiceManager;
@@ -64,16 +68,22 @@ class AdBlockService : public AdBlockBaseService {
       const GURL& url,
       blink::mojom::ResourceType resource_type,
       const std::string& tab_host);
-  absl::optional<base::Value> UrlCosmeticResources(
+  cosmetic_filters::mojom::CosmeticResourcesPtr UrlCosmeticResources(
       const std::string& url) override;
-  absl::optional<base::Value> HiddenClassIdSelectors(
+  cosmetic_filters::mojom::CosmeticResourcesPtr HiddenClassIdSelectors(
       const std::vector<std::string>& classes,
       const std::vector<std::string>& ids,
       const std::vector<std::string>& exceptions) override;
 
+  // Returns the task runner that ShouldStartRequest() and GetCspDirectives()
+  // should be called on. Tasks posted to it may run concurrently.
+  scoped_refptr<base::TaskRunner> GetMatchingTaskRunner();
+
   AdBlockRegionalServiceManager* regional_service_manager();
   AdBlockCustomFiltersService* custom_filters_service();
   AdBlockSubscriptionServiceManager* subscription_service_manager();
+  // Returns nullptr unless the combined engine is enabled.
+  AdBlockEngineMerger* engine_merger();
 
  protected:
   bool Init() override;
@@ -82,6 +92,14 @@ class AdBlockService : public AdBlockBaseService {
                         const std::string& manifest) override;
   void OnResourcesFileDataReady(const std::string& resources);
   void OnRegionalCatalogFileDataReady(const std::string& catalog_json);
+  void MatchRequest(const GURL& url,
+                    blink::mojom::ResourceType resource_type,
+                    const std::string& tab_host,
+                    bool aggressive_blocking,
+                    bool* did_match_rule,
+                    bool* did_match_exception,
+                    bool* did_match_important,
+                    std::string* mock_data_url);
 
  private:
   friend class ::AdBlockServiceTest;
@@ -94,7 +112,12 @@ class AdBlockService : public AdBlockBaseService {
       const std::string& component_base64_public_key);
 
   BraveComponent::Delegate* component_delegate_;
+  scoped_refptr<base::TaskRunner> matching_task_runner_;
 
+  // Declared before the services that reference it.
+  std::unique_ptr<brave_shields::AdBlockEngineMerger> engine_merger_;
+  // Null unless the decision cache is enabled.
+  std::unique_ptr<brave_shields::AdBlockDecisionCache> decision_cache_;
   std::unique_ptr<brave_shields::AdBlockRegionalServiceManager>
       regional_service_manager_;
   std::unique_ptr<brave_shields::AdBlockCustomFiltersService>
@@ -6,18 +6,61 @@
 #include "brave/components/brave_shields/browser/ad_block_service_helper.h"
 
 #include <algorithm>
+#include <iterator>
 #include <utility>
 
+#include "base/containers/flat_map.h"
 #include "base/json/json_reader.h"
 #include "base/logging.h"
 #include "base/path_service.h"
 #include "base/strings/string_util.h"
 #include "base/values.h"
+#include "net/base/registry_controlled_domains/registry_controlled_domain.h"
+#include "url/gurl.h"
+#include "url/url_util.h"
 
 using adblock::FilterList;
+using namespace net::registry_controlled_domains;  // NOLINT
 
 namespace brave_shields {
 
+namespace {
+
+// Returns the eTLD+1 of |host| as a view into it, or an empty piece for IP
+// addresses and hosts without a known registry.
+base::StringPiece GetDomainAndRegistryPiece(base::StringPiece host) {
+  if (url::HostIsIPAddress(host))
+    return base::StringPiece();
+  const size_t registry_length = GetCanonicalHostRegistryLength(
+      host, EXCLUDE_UNKNOWN_REGISTRIES, INCLUDE_PRIVATE_REGISTRIES);
+  if (registry_length == std::string::npos || registry_length == 0 ||
+      registry_length + 2 > host.length())
+    return base::StringPiece();
+  const size_t dot = host.rfind('.', host.length() - registry_length - 2);
+  if (dot == base::StringPiece::npos)
+    return host;
+  return host.substr(dot + 1);
+}
+
+base::Value StringsToValue(const std::vector<std::string>& strings) {
+  base::Value list(base::Value::Type::LIST);
+  for (const auto& string : strings)
+    list.Append(string);
+  return list;
+}
+
+}  // namespace
+
+void AppendSelectorsInto(std::vector<std::string> from,
+                         std::vector<std::string>* into) {
+  if (into->empty()) {
+    *into = std::move(from);
+    return;
+  }
+  into->insert(into->end(), std::make_move_iterator(from.begin()),
+               std::make_move_iterator(from.end()));
+}
+
 std::vector<FilterList>::const_iterator FindAdBlockFilterListByUUID(
     const std::vector<FilterList>& region_lists,
     const std::string& uuid) {
@@ -116,6 +159,85 @@ std::vector<FilterList> RegionalCatalogFromJSON(
   return catalog;
 }
 
+adblock::ResourceType ResourceTypeToEngineType(
+    blink::mojom::ResourceType resource_type) {
+  adblock::ResourceType filter_option = adblock::ResourceType::kUnknown;
+  switch (resource_type) {
+    // top level page
+    case blink::mojom::ResourceType::kMainFrame:
+      filter_option = adblock::ResourceType::kMainFrame;
+      break;
+    // frame or iframe
+    case blink::mojom::ResourceType::kSubFrame:
+      filter_option = adblock::ResourceType::kSubFrame;
+      break;
+    // a CSS stylesheet
+    case blink::mojom::ResourceType::kStylesheet:
+      filter_option = adblock::ResourceType::kStylesheet;
+      break;
+    // an external script
+    case blink::mojom::ResourceType::kScript:
+      filter_option = adblock::ResourceType::kScript;
+      break;
+    // an image (jpg/gif/png/etc)
+    case blink::mojom::ResourceType::kFavicon:
+    case blink::mojom::ResourceType::kImage:
+      filter_option = adblock::ResourceType::kImage;
+      break;
+    // a font
+    case blink::mojom::ResourceType::kFontResource:
+      filter_option = adblock::ResourceType::kFont;
+      break;
+    // an "other" subresource.
+    case blink::mojom::ResourceType::kSubResource:
+      filter_option = adblock::ResourceType::kOther;
+      break;
+    // an object (or embed) tag for a plugin.
+    case blink::mojom::ResourceType::kObject:
+      filter_option = adblock::ResourceType::kObject;
+      break;
+    // a media resource.
+    case blink::mojom::ResourceType::kMedia:
+      filter_option = adblock::ResourceType::kMedia;
+      break;
+    // a XMLHttpRequest
+    case blink::mojom::ResourceType::kXhr:
+      filter_option = adblock::ResourceType::kXhr;
+      break;
+    // a ping request for <a ping>/sendBeacon.
+    case blink::mojom::ResourceType::kPing:
+      filter_option = adblock::ResourceType::kPing;
+      break;
+    // the main resource of a dedicated worker.
+    case blink::mojom::ResourceType::kWorker:
+    // the main resource of a shared worker.
+    case blink::mojom::ResourceType::kSharedWorker:
+    // an explicitly requested prefetch
+    case blink::mojom::ResourceType::kPrefetch:
+    // the main resource of a service worker.
+    case blink::mojom::ResourceType::kServiceWorker:
+    // a report of Content Security Policy violations.
+    case blink::mojom::ResourceType::kCspReport:
+    // a resource that a plugin requested.
+    case blink::mojom::ResourceType::kPluginResource:
+    default:
+      break;
+  }
+  return filter_option;
+}
+
+// Mirrors net::registry_controlled_domains::SameDomainOrHost(), but works on
+// a host string and never allocates.
+bool IsThirdPartyRequest(const GURL& url, base::StringPiece tab_host) {
+  const base::StringPiece host = url.host_piece();
+  if (host.empty() || tab_host.empty())
+    return true;
+  if (host == tab_host)
+    return false;
+  const base::StringPiece domain = GetDomainAndRegistryPiece(host);
+  return domain.empty() || domain != GetDomainAndRegistryPiece(tab_host);
+}
+
 // Merges the first CSP directive into the second one provided, if they exist.
 //
 // Distinct policies are merged with comma separators, according to
@@ -139,80 +261,76 @@ void MergeCspDirectiveInto(absl::optional<std::string> from,
   *into = absl::optional<std::string>(from_str + ", " + into_str);
 }
 
-// Merges the contents of the first UrlCosmeticResources Value into the second
-// one provided.
+// Merges the contents of the first CosmeticResources into the second one
+// provided.
 //
 // If `force_hide` is true, the contents of `from`'s `hide_selectors` field
-// will be moved into a possibly new field of `into` called
-// `force_hide_selectors`.
-void MergeResourcesInto(base::Value from, base::Value* into, bool force_hide) {
-  base::Value* resources_hide_selectors = nullptr;
-  if (force_hide) {
-    resources_hide_selectors = into->FindKey("force_hide_selectors");
-    if (!resources_hide_selectors || !resources_hide_selectors->is_list()) {
-        into->SetKey("force_hide_selectors", base::ListValue());
-        resources_hide_selectors = into->FindKey("force_hide_selectors");
-    }
+// will be moved into the `force_hide_selectors` field of `into`.
+void MergeResourcesInto(cosmetic_filters::mojom::CosmeticResourcesPtr from,
+                        cosmetic_filters::mojom::CosmeticResources* into,
+                        bool force_hide) {
+  DCHECK(from);
+  DCHECK(into);
+
+  AppendSelectorsInto(std::move(from->hide_selectors),
+                      force_hide ? &into->force_hide_selectors
+                                 : &into->hide_selectors);
+  AppendSelectorsInto(std::move(from->force_hide_selectors),
+                      &into->force_hide_selectors);
+
+  if (into->style_selectors.empty()) {
+    into->style_selectors = std::move(from->style_selectors);
   } else {
-    resources_hide_selectors = into->FindKey("hide_selectors");
-  }
-  base::Value* from_resources_hide_selectors =
-      from.FindKey("hide_selectors");
-  if (resources_hide_selectors && from_resources_hide_selectors) {
-    for (auto i = from_resources_hide_selectors->GetList().begin();
-            i < from_resources_hide_selectors->GetList().end();
-            i++) {
-      resources_hide_selectors->Append(std::move(*i));
+    for (auto& entry : from->style_selectors) {
+      AppendSelectorsInto(std::move(entry.second),
+                          &into->style_selectors[entry.first]);
     }
   }
 
-  base::Value* resources_style_selectors = into->FindKey("style_selectors");
-  base::Value* from_resources_style_selectors =
-      from.FindKey("style_selectors");
-  if (resources_style_selectors && from_resources_style_selectors) {
-    for (auto i : from_resources_style_selectors->DictItems()) {
-      base::Value* resources_entry =
-          resources_style_selectors->FindKey(i.first);
-      if (resources_entry) {
-        for (auto j = i.second.GetList().begin();
-                j < i.second.GetList().end();
-                j++) {
-          resources_entry->Append(std::move(*j));
-        }
-      } else {
-        resources_style_selectors->SetKey(i.first, std::move(i.second));
-      }
-    }
-  }
+  AppendSelectorsInto(std::move(from->exceptions), &into->exceptions);
 
-  base::Value* resources_exceptions = into->FindKey("exceptions");
-  base::Value* from_resources_exceptions = from.FindKey("exceptions");
-  if (resources_exceptions && from_resources_exceptions) {
-    for (auto i = from_resources_exceptions->GetList().begin();
-            i < from_resources_exceptions->GetList().end();
-            i++) {
-      resources_exceptions->Append(std::move(*i));
-    }
-  }
+  into->injected_script += '\n';
+  into->injected_script += from->injected_script;
 
-  base::Value* resources_injected_script = into->FindKey("injected_script");
-  base::Value* from_resources_injected_script =
-      from.FindKey("injected_script");
-  if (resources_injected_script && from_resources_injected_script) {
-    *resources_injected_script = base::Value(
-            resources_injected_script->GetString()
-            + '\n'
-            + from_resources_injected_script->GetString());
-  }
+  into->generichide |= from->generichide;
+}
 
-  base::Value* resources_generichide = into->FindKey("generichide");
-  base::Value* from_resources_generichide =
-      from.FindKey("generichide");
-  if (from_resources_generichide) {
-    if (from_resources_generichide->GetBool()) {
-      *resources_generichide = base::Value(true);
-    }
-  }
+// Moves the url-specific resources of a single engine into a new
+// CosmeticResources.
+cosmetic_filters::mojom::CosmeticResourcesPtr ToCosmeticResources(
+    adblock::CosmeticResources resources) {
+  auto result = cosmetic_filters::mojom::CosmeticResources::New();
+  result->hide_selectors = std::move(resources.hide_selectors);
+  std::vector<std::pair<std::string, std::vector<std::string>>> styles;
+  styles.reserve(resources.style_selectors.size());
+  for (auto& entry : resources.style_selectors)
+    styles.emplace_back(entry.first, std::move(entry.second));
+  // The entries are already sorted, so the map is built without reordering.
+  result->style_selectors =
+      base::flat_map<std::string, std::vector<std::string>>(
+          base::sorted_unique, std::move(styles));
+  result->exceptions = std::move(resources.exceptions);
+  result->injected_script = std::move(resources.injected_script);
+  result->generichide = resources.generichide;
+  return result;
+}
+
+// Converts |resources| to the dictionary layout produced by adblock-rust's
+// JSON serialization, for consumers that need a base::Value.
+base::Value CosmeticResourcesToValue(
+    const cosmetic_filters::mojom::CosmeticResources& resources) {
+  base::Value result(base::Value::Type::DICTIONARY);
+  result.SetKey("hide_selectors", StringsToValue(resources.hide_selectors));
+  result.SetKey("force_hide_selectors",
+                StringsToValue(resources.force_hide_selectors));
+  base::Value style_selectors(base::Value::Type::DICTIONARY);
+  for (const auto& entry : resources.style_selectors)
+    style_selectors.SetKey(entry.first, StringsToValue(entry.second));
+  result.SetKey("style_selectors", std::move(style_selectors));
+  result.SetKey("exceptions", StringsToValue(resources.exceptions));
+  result.SetStringKey("injected_script", resources.injected_script);
+  result.SetBoolKey("generichide", resources.generichide);
+  return result;
 }
 
 }  // namespace brave_shields
@@ -11,8 +11,14 @@
 #include <vector>
 
 #include "base/files/file_path.h"
+#include "base/strings/string_piece.h"
 #include "base/values.h"
 #include "brave/components/adblock_rust_ffi/src/wrapper.h"
+#include "brave/components/cosmetic_filters/common/cosmetic_filters.mojom.h"
+#include "third_party/abseil-cpp/absl/types/optional.h"
+#include "third_party/blink/public/mojom/loader/resource_load_info.mojom-shared.h"
+
+class GURL;
 
 namespace brave_shields {
 
@@ -26,10 +32,31 @@ std::vector<adblock::FilterList>::const_iterator FindAdBlockFilterListByLocale(
 std::vector<adblock::FilterList> RegionalCatalogFromJSON(
     const std::string& catalog_json);
 
+// Returns the adblock-rust request type matching |resource_type|, or kUnknown
+// if there is none.
+adblock::ResourceType ResourceTypeToEngineType(
+    blink::mojom::ResourceType resource_type);
+
+// Returns true if |url| is not same-site with |tab_host|, as decided by
+// net::registry_controlled_domains::SameDomainOrHost(), without allocating.
+bool IsThirdPartyRequest(const GURL& url, base::StringPiece tab_host);
+
 void MergeCspDirectiveInto(absl::optional<std::string> from,
                            absl::optional<std::string>* into);
 
-void MergeResourcesInto(base::Value from, base::Value* into, bool force_hide);
+// Moves all of |from| to the end of |into|.
+void AppendSelectorsInto(std::vector<std::string> from,
+                         std::vector<std::string>* into);
+
+void MergeResourcesInto(cosmetic_filters::mojom::CosmeticResourcesPtr from,
+                        cosmetic_filters::mojom::CosmeticResources* into,
+                        bool force_hide);
+
+cosmetic_filters::mojom::CosmeticResourcesPtr ToCosmeticResources(
+    adblock::CosmeticResources resources);
+
+base::Value CosmeticResourcesToValue(
+    const cosmetic_filters::mojom::CosmeticResources& resources);
 
 }  // namespace brave_shields
 
@@ -0,0 +1,440 @@
+/* Copyright (c) 2021 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/command_line.h"
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/json/json_reader.h"
+#include "base/logging.h"
+#include "base/path_service.h"
+#include "base/strings/string_split.h"
+#include "base/test/scoped_feature_list.h"
+#include "base/threading/thread_task_runner_handle.h"
+#include "base/time/time.h"
+#include "base/values.h"
+#include "brave/components/adblock_rust_ffi/src/wrapper.h"
+#include "brave/components/brave_component_updater/browser/brave_component.h"
+#include "brave/components/brave_shields/browser/ad_block_custom_filters_service.h"
+#include "brave/components/brave_shields/browser/ad_block_decision_cache.h"
+#include "brave/components/brave_shields/browser/ad_block_regional_service.h"
+#include "brave/components/brave_shields/browser/ad_block_regional_service_manager.h"
+#include "brave/components/brave_shields/browser/ad_block_service.h"
+#include "brave/components/brave_shields/browser/ad_block_subscription_download_manager.h"
+#include "brave/components/brave_shields/browser/ad_block_subscription_service_manager.h"
+#include "brave/components/brave_shields/common/features.h"
+#include "brave/test/base/scoped_allocation_counter.h"
+#include "content/public/test/browser_task_environment.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+#include "url/gurl.h"
+
+// Measures the shields entry points end to end, with the default, a regional
+// and the custom filter lists loaded, against a request corpus.
+//
+// Meaningful numbers need a recorded corpus, passed with
+// --adblock-perf-corpus-dir=<dir>. Without it, the tests only run as smoke
+// tests against the hand-written sample in brave/test/data/adblock-perf, and
+// their stories are reported with a "_smoke" suffix so that the two are never
+// compared. The corpus directory holds:
+//   default.txt, regional.txt, custom.txt  filter lists
+//   resources.json                          redirect resources
+//   requests.json       one {"url", "frameUrl", "cpt"} object per line, the
+//                       format of adblock-rust's request benchmarks
+//   cosmetic_pages.json one {"url", "classes", "ids"} object per line
+
+using brave_component_updater::BraveComponent;
+using brave_shields::AdBlockBaseService;
+using brave_shields::AdBlockDecisionCache;
+using brave_shields::AdBlockRegionalService;
+using brave_shields::AdBlockRegionalServiceManager;
+using brave_shields::AdBlockService;
+
+namespace {
+
+constexpr int kPasses = 50;
+constexpr char kCorpusDirSwitch[] = "adblock-perf-corpus-dir";
+constexpr char kRegionalUuid[] = "9F2D5C63-1E05-4A3B-9A6C-2C7E1B0D4F18";
+
+class TestingBraveComponentDelegate : public BraveComponent::Delegate {
+ public:
+  TestingBraveComponentDelegate() = default;
+  ~TestingBraveComponentDelegate() override = default;
+
+  TestingBraveComponentDelegate(const TestingBraveComponentDelegate&) =
+      delete;
+  TestingBraveComponentDelegate& operator=(
+      const TestingBraveComponentDelegate&) = delete;
+
+  using ComponentObserver = update_client::UpdateClient::Observer;
+
+  // BraveComponent::Delegate implementation. Lists are loaded directly by the
+  // test, so components are never installed.
+  void Register(const std::string& component_name,
+                const std::string& component_base64_public_key,
+                base::OnceClosure registered_callback,
+                BraveComponent::ReadyCallback ready_callback) override {}
+  bool Unregister(const std::string& component_id) override { return true; }
+  void OnDemandUpdate(const std::string& component_id) override {}
+  void AddObserver(ComponentObserver* observer) override {}
+  void RemoveObserver(ComponentObserver* observer) override {}
+  scoped_refptr<base::SequencedTaskRunner> GetTaskRunner() override {
+    return base::ThreadTaskRunnerHandle::Get();
+  }
+  const std::string locale() const override { return "fr"; }
+  PrefService* local_state() override { return nullptr; }
+};
+
+void NoDownloadManager(
+    base::OnceCallback<void(brave_shields::AdBlockSubscriptionDownloadManager*)>
+        callback) {}
+
+struct CorpusRequest {
+  GURL url;
+  blink::mojom::ResourceType resource_type;
+  std::string tab_host;
+};
+
+struct CorpusPage {
+  std::string url;
+  std::vector<std::string> classes;
+  std::vector<std::string> ids;
+  // Filled from the page's UrlCosmeticResources() result.
+  std::vector<std::string> exceptions;
+};
+
+// Maps the content policy types used by adblock-rust's request format.
+blink::mojom::ResourceType ResourceTypeFromCpt(const std::string& cpt) {
+  if (cpt == "main_frame")
+    return blink::mojom::ResourceType::kMainFrame;
+  if (cpt == "sub_frame")
+    return blink::mojom::ResourceType::kSubFrame;
+  if (cpt == "stylesheet")
+    return blink::mojom::ResourceType::kStylesheet;
+  if (cpt == "script")
+    return blink::mojom::ResourceType::kScript;
+  if (cpt == "image")
+    return blink::mojom::ResourceType::kImage;
+  if (cpt == "font")
+    return blink::mojom::ResourceType::kFontResource;
+  if (cpt == "media")
+    return blink::mojom::ResourceType::kMedia;
+  if (cpt == "xmlhttprequest")
+    return blink::mojom::ResourceType::kXhr;
+  if (cpt == "ping")
+    return blink::mojom::ResourceType::kPing;
+  return blink::mojom::ResourceType::kSubResource;
+}
+
+std::vector<std::string> StringsFromList(const base::Value* list) {
+  std::vector<std::string> strings;
+  if (!list || !list->is_list())
+    return strings;
+  for (const base::Value& item : list->GetList()) {
+    if (item.is_string())
+      strings.push_back(item.GetString());
+  }
+  return strings;
+}
+
+// Parses one JSON object per line, skipping lines that do not parse.
+std::vector<base::Value> ReadJsonLines(const base::FilePath& path) {
+  std::string contents;
+  EXPECT_TRUE(base::ReadFileToString(path, &contents)) << path;
+  std::vector<base::Value> objects;
+  for (const auto& line :
+       base::SplitStringPiece(contents, "\n", base::TRIM_WHITESPACE,
+                              base::SPLIT_WANT_NONEMPTY)) {
+    absl::optional<base::Value> value = base::JSONReader::Read(line);
+    if (value && value->is_dict())
+      objects.push_back(std::move(*value));
+  }
+  return objects;
+}
+
+std::vector<CorpusRequest> LoadRequests(const base::FilePath& path) {
+  std::vector<CorpusRequest> requests;
+  for (const base::Value& object : ReadJsonLines(path)) {
+    const std::string* url = object.FindStringKey("url");
+    const std::string* frame_url = object.FindStringKey("frameUrl");
+    const std::string* cpt = object.FindStringKey("cpt");
+    if (!url || !frame_url || !cpt)
+      continue;
+    CorpusRequest request = {GURL(*url), ResourceTypeFromCpt(*cpt),
+                               GURL(*frame_url).host()};
+    if (request.url.is_valid())
+      requests.push_back(std::move(request));
+  }
+  return requests;
+}
+
+std::vector<CorpusPage> LoadPages(const base::FilePath& path) {
+  std::vector<CorpusPage> pages;
+  for (const base::Value& object : ReadJsonLines(path)) {
+    const std::string* url = object.FindStringKey("url");
+    if (!url)
+      continue;
+    CorpusPage page;
+    page.url = *url;
+    page.classes = StringsFromList(object.FindListKey("classes"));
+    page.ids = StringsFromList(object.FindListKey("ids"));
+    pages.push_back(std::move(page));
+  }
+  return pages;
+}
+
+std::string ReadCorpusFile(const base::FilePath& dir, const char* name) {
+  std::string contents;
+  EXPECT_TRUE(base::ReadFileToString(dir.AppendASCII(name), &contents))
+      << name;
+  return contents;
+}
+
+}  // namespace
+
+class AdBlockServicePerfTest : public testing::Test {
+ public:
+  AdBlockServicePerfTest() {
+    // Off by default, but measured here against the uncached matching.
+    feature_list_.InitAndEnableFeature(
+        brave_shields::features::kBraveAdblockDecisionCache);
+  }
+  ~AdBlockServicePerfTest() override {}
+
+  void SetUp() override {
+    if (!HasRecordedCorpus()) {
+      LOG(WARNING) << "No --" << kCorpusDirSwitch
+                   << " given, running as a smoke test against the sample "
+                      "corpus. These numbers are not representative.";
+    }
+    const base::FilePath corpus_dir = GetCorpusDir();
+    requests_ = LoadRequests(corpus_dir.AppendASCII("requests.json"));
+    pages_ = LoadPages(corpus_dir.AppendASCII("cosmetic_pages.json"));
+    ASSERT_FALSE(requests_.empty());
+    ASSERT_FALSE(pages_.empty());
+
+    ASSERT_TRUE(profile_dir_.CreateUniqueTempDir());
+    service_ = std::make_unique<AdBlockService>(
+        &delegate_,
+        std::make_unique<brave_shields::AdBlockSubscriptionServiceManager>(
+            &delegate_, base::BindOnce(&NoDownloadManager),
+            profile_dir_.GetPath()));
+    service_->Start();
+
+    const std::string resources =
+        ReadCorpusFile(corpus_dir, "resources.json");
+    LoadList(service_.get(), ReadCorpusFile(corpus_dir, "default.txt"));
+    LoadList(service_->custom_filters_service(),
+             ReadCorpusFile(corpus_dir, "custom.txt"));
+    AddRegionalList(ReadCorpusFile(corpus_dir, "regional.txt"));
+    service_->AddResources(resources);
+    service_->custom_filters_service()->AddResources(resources);
+    service_->regional_service_manager()->AddResources(resources);
+    if (service_->engine_merger())
+      service_->engine_merger()->AddResources(resources);
+    // Lets the engine merger, if enabled, build its combined engine.
+    task_environment_.RunUntilIdle();
+
+    for (CorpusPage& page : pages_) {
+      page.exceptions =
+          service_->UrlCosmeticResources(page.url)->exceptions;
+    }
+  }
+
+  void TearDown() override {
+    service_.reset();
+    task_environment_.RunUntilIdle();
+  }
+
+ protected:
+  // Runs |operation(i)| for each of the |count| corpus entries, |kPasses|
+  // times, and reports its latency distribution, throughput and allocations.
+  // |before_pass| runs before each timed pass, outside of the measurements.
+  template <typename Operation, typename BeforePass>
+  void Measure(const std::string& story,
+               size_t count,
+               Operation operation,
+               BeforePass before_pass) {
+    ASSERT_GT(count, 0u);
+    std::vector<base::TimeDelta> latencies;
+    latencies.reserve(kPasses * count);
+
+    base::TimeDelta total;
+    for (int pass = 0; pass < kPasses; ++pass) {
+      before_pass();
+      const base::TimeTicks pass_start = base::TimeTicks::Now();
+      for (size_t i = 0; i < count; ++i) {
+        const base::TimeTicks start = base::TimeTicks::Now();
+        operation(i);
+        latencies.push_back(base::TimeTicks::Now() - start);
+      }
+      total += base::TimeTicks::Now() - pass_start;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    const size_t p99_index =
+        std::min(latencies.size() - 1, latencies.size() * 99 / 100);
+
+    perf_test::PerfResultReporter reporter(
+        "AdBlockService", HasRecordedCorpus() ? story : story + "_smoke");
+    reporter.RegisterImportantMetric(".p50", "us");
+    reporter.RegisterImportantMetric(".p99", "us");
+    reporter.RegisterImportantMetric(".throughput", "runs/s");
+    reporter.AddResult(".p50",
+                       latencies[latencies.size() / 2].InMicrosecondsF());
+    reporter.AddResult(".p99", latencies[p99_index].InMicrosecondsF());
+    reporter.AddResult(".throughput", latencies.size() / total.InSecondsF());
+
+    if (ScopedAllocationCounter::IsSupported()) {
+      // Counted on a separate pass so that the counter does not skew the
+      // latencies above.
+      before_pass();
+      uint64_t allocation_count = 0;
+      {
+        ScopedAllocationCounter allocation_counter;
+        for (size_t i = 0; i < count; ++i)
+          operation(i);
+        allocation_count = allocation_counter.count();
+      }
+      reporter.RegisterImportantMetric(".allocations", "count");
+      reporter.AddResult(".allocations",
+                         allocation_count / static_cast<double>(count));
+    }
+  }
+
+  template <typename Operation>
+  void Measure(const std::string& story, size_t count, Operation operation) {
+    Measure(story, count, operation, [] {});
+  }
+
+  bool ShouldBlock(const CorpusRequest& request) {
+    bool did_match_rule = false;
+    bool did_match_exception = false;
+    bool did_match_important = false;
+    std::string mock_data_url;
+    service_->ShouldStartRequest(request.url, request.resource_type,
+                                 request.tab_host, false, &did_match_rule,
+                                 &did_match_exception, &did_match_important,
+                                 &mock_data_url);
+    return did_match_important || (did_match_rule && !did_match_exception);
+  }
+
+  std::vector<CorpusRequest> requests_;
+  std::vector<CorpusPage> pages_;
+  std::unique_ptr<AdBlockService> service_;
+
+ private:
+  static bool HasRecordedCorpus() {
+    return base::CommandLine::ForCurrentProcess()->HasSwitch(kCorpusDirSwitch);
+  }
+
+  static base::FilePath GetCorpusDir() {
+    if (HasRecordedCorpus()) {
+      return base::CommandLine::ForCurrentProcess()->GetSwitchValuePath(
+          kCorpusDirSwitch);
+    }
+
+    base::FilePath source_root;
+    base::PathService::Get(base::DIR_SOURCE_ROOT, &source_root);
+    return source_root.AppendASCII("brave")
+        .AppendASCII("test")
+        .AppendASCII("data")
+        .AppendASCII("adblock-perf");
+  }
+
+  // Loads |rules| the way text lists are loaded in the browser, so that they
+  // join the combined engine when the engine merger is enabled.
+  void LoadList(AdBlockBaseService* service, const std::string& rules) {
+    service->UpdateAdBlockClientFromRules(rules);
+  }
+
+  // Installs a regional list without going through prefs and the component
+  // updater, which need local state.
+  void AddRegionalList(const std::string& rules) {
+    AdBlockRegionalServiceManager* manager =
+        service_->regional_service_manager();
+    std::vector<adblock::FilterList> catalog;
+    catalog.push_back(adblock::FilterList(
+        kRegionalUuid, "https://example.com/regional.txt",
+        "Perf Test Regional List", {"fr"}, "https://support.brave.com",
+        "componentid", "base64publickey", "Regional list for perf tests"));
+    manager->SetRegionalCatalog(std::move(catalog));
+
+    AdBlockRegionalService* regional_service =
+        manager->StartRegionalServiceForTesting(kRegionalUuid);
+    LoadList(regional_service, rules);
+  }
+
+  base::test::ScopedFeatureList feature_list_;
+  content::BrowserTaskEnvironment task_environment_;
+  TestingBraveComponentDelegate delegate_;
+  base::ScopedTempDir profile_dir_;
+};
+
+TEST_F(AdBlockServicePerfTest, ShouldStartRequest) {
+  int blocked = 0;
+  Measure("ShouldStartRequest", requests_.size(),
+          [&](size_t i) { blocked += ShouldBlock(requests_[i]); });
+  // Keeps the loop from being optimized away, and catches broken corpora.
+  EXPECT_GT(blocked, 0);
+}
+
+TEST_F(AdBlockServicePerfTest, ShouldStartRequestUncached) {
+  int blocked = 0;
+  Measure(
+      "ShouldStartRequestUncached", requests_.size(),
+      [&](size_t i) { blocked += ShouldBlock(requests_[i]); },
+      [] { AdBlockDecisionCache::InvalidateAll(); });
+  EXPECT_GT(blocked, 0);
+}
+
+TEST_F(AdBlockServicePerfTest, GetCspDirectives) {
+  // CSP directives are only looked up for documents.
+  std::vector<CorpusRequest> documents;
+  for (const CorpusRequest& request : requests_) {
+    if (request.resource_type == blink::mojom::ResourceType::kMainFrame ||
+        request.resource_type == blink::mojom::ResourceType::kSubFrame) {
+      documents.push_back(request);
+    }
+  }
+
+  int with_csp = 0;
+  Measure("GetCspDirectives", documents.size(), [&](size_t i) {
+    with_csp += !!service_->GetCspDirectives(
+        documents[i].url, documents[i].resource_type, documents[i].tab_host);
+  });
+  EXPECT_GT(with_csp, 0);
+}
+
+TEST_F(AdBlockServicePerfTest, UrlCosmeticResources) {
+  size_t selectors = 0;
+  Measure("UrlCosmeticResources", pages_.size(), [&](size_t i) {
+    selectors +=
+        service_->UrlCosmeticResources(pages_[i].url)->hide_selectors.size();
+  });
+  EXPECT_GT(selectors, 0u);
+}
+
+TEST_F(AdBlockServicePerfTest, HiddenClassIdSelectors) {
+  size_t selectors = 0;
+  Measure("HiddenClassIdSelectors", pages_.size(), [&](size_t i) {
+    const CorpusPage& page = pages_[i];
+    cosmetic_filters::mojom::CosmeticResourcesPtr resources =
+        service_->HiddenClassIdSelectors(page.classes, page.ids,
+                                         page.exceptions);
+    selectors += resources->hide_selectors.size() +
+                 resources->force_hide_selectors.size();
+  });
+  EXPECT_GT(selectors, 0u);
+}
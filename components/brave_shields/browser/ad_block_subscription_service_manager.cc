@@ -20,6 +20,8 @@
 #include "base/util/values/values_util.h"
 #include "base/values.h"
 #include "brave/components/adblock_rust_ffi/src/wrapper.h"
+#include "brave/components/brave_shields/browser/ad_block_decision_cache.h"
+#include "brave/components/brave_shields/browser/ad_block_engine_merger.h"
 #include "brave/components/brave_shields/browser/ad_block_service_helper.h"
 #include "brave/components/brave_shields/browser/ad_block_subscription_service.h"
 #include "brave/components/brave_shields/browser/ad_block_subscription_service_manager_observer.h"
@@ -114,31 +116,40 @@ void AdBlockSubscriptionServiceManager::OnUpdateTimer(
   if (!local_state)
     return;
 
-  base::AutoLock lock(subscription_services_lock_);
-  subscriptions_ = base::DictionaryValue::From(base::Value::ToUniquePtrValue(
-      local_state->GetDictionary(prefs::kAdBlockListSubscriptions)->Clone()));
-
-  for (base::DictionaryValue::Iterator it(*subscriptions_); !it.IsAtEnd();
-       it.Advance()) {
-    const std::string key = it.key();
-    SubscriptionInfo info;
-    const base::Value* list_subscription_dict =
-        subscriptions_->FindDictKey(key);
-    if (list_subscription_dict) {
-      GURL sub_url(key);
-      info = BuildInfoFromDict(sub_url, list_subscription_dict);
-
-      base::TimeDelta until_next_refresh =
-          kListUpdateInterval - (base::Time::Now() - info.last_update_attempt);
-
-      if (info.enabled &&
-          ((info.last_update_attempt != info.last_successful_update_attempt) ||
-           (until_next_refresh <= base::TimeDelta()))) {
-        StartDownload(sub_url, false);
+  std::vector<GURL> sub_urls_to_download;
+  {
+    base::AutoLock lock(subscription_services_lock_);
+    subscriptions_ = base::DictionaryValue::From(base::Value::ToUniquePtrValue(
+        local_state->GetDictionary(prefs::kAdBlockListSubscriptions)->Clone()));
+
+    for (base::DictionaryValue::Iterator it(*subscriptions_); !it.IsAtEnd();
+         it.Advance()) {
+      const std::string key = it.key();
+      SubscriptionInfo info;
+      const base::Value* list_subscription_dict =
+          subscriptions_->FindDictKey(key);
+      if (list_subscription_dict) {
+        GURL sub_url(key);
+        info = BuildInfoFromDict(sub_url, list_subscription_dict);
+
+        base::TimeDelta until_next_refresh =
+            kListUpdateInterval -
+            (base::Time::Now() - info.last_update_attempt);
+
+        if (info.enabled && ((info.last_update_attempt !=
+                              info.last_successful_update_attempt) ||
+                             (until_next_refresh <= base::TimeDelta()))) {
+          sub_urls_to_download.push_back(sub_url);
+        }
       }
     }
   }
 
+  // Started without the lock, since a failed download reports back through
+  // GetInfo().
+  for (const auto& sub_url : sub_urls_to_download)
+    StartDownload(sub_url, false);
+
   std::move(on_finished).Run();
 }
 
@@ -167,6 +178,8 @@ void AdBlockSubscriptionServiceManager::CreateSubscription(
   auto subscription_service = std::make_unique<AdBlockSubscriptionService>(
       info, GetSubscriptionPath(sub_url).Append(kCustomSubscriptionListText),
       delegate_);
+  if (engine_merger_)
+    subscription_service->SetEngineMerger(engine_merger_, sub_url.spec());
   UpdateSubscriptionPrefs(sub_url, info);
 
   {
@@ -202,11 +215,18 @@ void AdBlockSubscriptionServiceManager::EnableSubscription(const GURL& sub_url,
   info->enabled = enabled;
 
   UpdateSubscriptionPrefs(sub_url, *info);
+
+  if (engine_merger_)
+    engine_merger_->SetSourceEnabled(sub_url.spec(), enabled);
+  AdBlockDecisionCache::InvalidateAll();
 }
 
 void AdBlockSubscriptionServiceManager::DeleteSubscription(
     const GURL& sub_url) {
   DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+  // Removed first, so that no merged callback runs on the destroyed service.
+  if (engine_merger_)
+    engine_merger_->RemoveRules(sub_url.spec());
   {
     base::AutoLock lock(subscription_services_lock_);
     auto it = subscription_services_.find(sub_url);
@@ -214,6 +234,7 @@ void AdBlockSubscriptionServiceManager::DeleteSubscription(
     subscription_services_.erase(it);
   }
   ClearSubscriptionPrefs(sub_url);
+  AdBlockDecisionCache::InvalidateAll();
 
   base::ThreadPool::PostTask(
       FROM_HERE,
@@ -229,6 +250,12 @@ void AdBlockSubscriptionServiceManager::RefreshSubscription(const GURL& sub_url,
   StartDownload(sub_url, true);
 }
 
+void AdBlockSubscriptionServiceManager::SetEngineMerger(
+    AdBlockEngineMerger* engine_merger) {
+  DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+  engine_merger_ = engine_merger;
+}
+
 void AdBlockSubscriptionServiceManager::OnGetDownloadManager(
     AdBlockSubscriptionDownloadManager* download_manager) {
   DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
@@ -268,6 +295,12 @@ void AdBlockSubscriptionServiceManager::SetUpdateIntervalsForTesting(
 
 absl::optional<SubscriptionInfo> AdBlockSubscriptionServiceManager::GetInfo(
     const GURL& sub_url) {
+  base::AutoLock lock(subscription_services_lock_);
+  return GetInfoLocked(sub_url);
+}
+
+absl::optional<SubscriptionInfo>
+AdBlockSubscriptionServiceManager::GetInfoLocked(const GURL& sub_url) {
   auto* list_subscription_dict = subscriptions_->FindKey(sub_url.spec());
   if (!list_subscription_dict)
     return absl::nullopt;
@@ -301,6 +334,10 @@ void AdBlockSubscriptionServiceManager::LoadSubscriptionServices() {
           info,
           GetSubscriptionPath(sub_url).Append(kCustomSubscriptionListText),
           delegate_);
+      if (engine_merger_) {
+        subscription_service->SetEngineMerger(engine_merger_, sub_url.spec());
+        engine_merger_->SetSourceEnabled(sub_url.spec(), info.enabled);
+      }
 
       subscription_services_.insert(
           std::make_pair(sub_url, std::move(subscription_service)));
@@ -373,7 +410,7 @@ void AdBlockSubscriptionServiceManager::ShouldStartRequest(
     std::string* mock_data_url) {
   base::AutoLock lock(subscription_services_lock_);
   for (const auto& subscription_service : subscription_services_) {
-    auto info = GetInfo(subscription_service.first);
+    auto info = GetInfoLocked(subscription_service.first);
     if (info && info->enabled) {
       subscription_service.second->ShouldStartRequest(
           url, resource_type, tab_host, aggressive_blocking, did_match_rule,
@@ -401,22 +438,20 @@ void AdBlockSubscriptionServiceManager::AddResources(
   }
 }
 
-absl::optional<base::Value>
+cosmetic_filters::mojom::CosmeticResourcesPtr
 AdBlockSubscriptionServiceManager::UrlCosmeticResources(
     const std::string& url) {
-  absl::optional<base::Value> first_value = absl::nullopt;
+  cosmetic_filters::mojom::CosmeticResourcesPtr first_value;
 
   base::AutoLock lock(subscription_services_lock_);
   for (auto it = subscription_services_.begin();
        it != subscription_services_.end(); it++) {
-    auto info = GetInfo(it->first);
+    auto info = GetInfoLocked(it->first);
     if (info && info->enabled) {
-      absl::optional<base::Value> next_value =
+      cosmetic_filters::mojom::CosmeticResourcesPtr next_value =
           it->second->UrlCosmeticResources(url);
       if (first_value) {
-        if (next_value) {
-          MergeResourcesInto(std::move(*next_value), &*first_value, false);
-        }
+        MergeResourcesInto(std::move(next_value), first_value.get(), false);
       } else {
         first_value = std::move(next_value);
       }
@@ -426,27 +461,23 @@ AdBlockSubscriptionServiceManager::UrlCosmeticResources(
   return first_value;
 }
 
-absl::optional<base::Value>
+cosmetic_filters::mojom::CosmeticResourcesPtr
 AdBlockSubscriptionServiceManager::HiddenClassIdSelectors(
     const std::vector<std::string>& classes,
     const std::vector<std::string>& ids,
     const std::vector<std::string>& exceptions) {
-  absl::optional<base::Value> first_value = absl::nullopt;
+  cosmetic_filters::mojom::CosmeticResourcesPtr first_value;
 
   base::AutoLock lock(subscription_services_lock_);
   for (auto it = subscription_services_.begin();
        it != subscription_services_.end(); it++) {
-    auto info = GetInfo(it->first);
+    auto info = GetInfoLocked(it->first);
     if (info && info->enabled) {
-      absl::optional<base::Value> next_value =
+      cosmetic_filters::mojom::CosmeticResourcesPtr next_value =
           it->second->HiddenClassIdSelectors(classes, ids, exceptions);
-      if (first_value && first_value->is_list()) {
-        if (next_value && next_value->is_list()) {
-          for (auto i = next_value->GetList().begin();
-               i < next_value->GetList().end(); i++) {
-            first_value->Append(std::move(*i));
-          }
-        }
+      if (first_value) {
+        AppendSelectorsInto(std::move(next_value->hide_selectors),
+                            &first_value->hide_selectors);
       } else {
         first_value = std::move(next_value);
       }
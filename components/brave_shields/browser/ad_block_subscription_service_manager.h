@@ -16,11 +16,13 @@
 #include "base/memory/weak_ptr.h"
 #include "base/one_shot_event.h"
 #include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
 #include "base/threading/thread_checker.h"
 #include "base/values.h"
 #include "brave/components/brave_component_updater/browser/brave_component.h"
 #include "brave/components/brave_shields/browser/ad_block_subscription_download_manager.h"
 #include "brave/components/brave_shields/browser/ad_block_subscription_service.h"
+#include "brave/components/cosmetic_filters/common/cosmetic_filters.mojom.h"
 #include "components/component_updater/timer_update_scheduler.h"
 #include "third_party/abseil-cpp/absl/types/optional.h"
 #include "url/gurl.h"
@@ -28,6 +30,7 @@
 class PrefService;
 
 namespace brave_shields {
+class AdBlockEngineMerger;
 class AdBlockSubscriptionServiceManagerObserver;
 }
 
@@ -69,8 +72,9 @@ class AdBlockSubscriptionServiceManager {
   void EnableTag(const std::string& tag, bool enabled);
   void AddResources(const std::string& resources);
 
-  absl::optional<base::Value> UrlCosmeticResources(const std::string& url);
-  absl::optional<base::Value> HiddenClassIdSelectors(
+  cosmetic_filters::mojom::CosmeticResourcesPtr UrlCosmeticResources(
+      const std::string& url);
+  cosmetic_filters::mojom::CosmeticResourcesPtr HiddenClassIdSelectors(
       const std::vector<std::string>& classes,
       const std::vector<std::string>& ids,
       const std::vector<std::string>& exceptions);
@@ -82,6 +86,10 @@ class AdBlockSubscriptionServiceManager {
   void OnSubscriptionDownloadFailure(const GURL& sub_url);
   void OnSubscriptionDownloaded(const GURL& sub_url);
 
+  // Makes subscriptions contribute their network rules to |engine_merger|'s
+  // combined engine. Must be called before any subscription is loaded.
+  void SetEngineMerger(AdBlockEngineMerger* engine_merger);
+
   void AddObserver(AdBlockSubscriptionServiceManagerObserver* observer);
   void RemoveObserver(AdBlockSubscriptionServiceManagerObserver* observer);
 
@@ -105,23 +113,30 @@ class AdBlockSubscriptionServiceManager {
       AdBlockSubscriptionDownloadManager* download_manager);
 
   absl::optional<SubscriptionInfo> GetInfo(const GURL& sub_url);
+  absl::optional<SubscriptionInfo> GetInfoLocked(const GURL& sub_url)
+      EXCLUSIVE_LOCKS_REQUIRED(subscription_services_lock_);
   void NotifyObserversOfServiceEvent();
 
   void SetUpdateIntervalsForTesting(base::TimeDelta* initial_delay,
                                     base::TimeDelta* retry_interval);
 
   brave_component_updater::BraveComponent::Delegate* delegate_;  // NOT OWNED
+  AdBlockEngineMerger* engine_merger_ = nullptr;                  // NOT OWNED
   base::WeakPtr<AdBlockSubscriptionDownloadManager> download_manager_;
   base::FilePath subscription_path_;
-  std::unique_ptr<base::DictionaryValue> subscriptions_;
 
+  // Requests are matched on any thread, so the subscriptions are changed with
+  // the lock held. The services are only changed on the owning thread, where
+  // they may also be read without it.
+  base::Lock subscription_services_lock_;
+  std::unique_ptr<base::DictionaryValue> subscriptions_
+      GUARDED_BY(subscription_services_lock_);
   std::map<GURL, std::unique_ptr<AdBlockSubscriptionService>>
       subscription_services_;
   std::unique_ptr<component_updater::TimerUpdateScheduler>
       subscription_update_timer_;
 
   base::ObserverList<AdBlockSubscriptionServiceManagerObserver> observers_;
-  base::Lock subscription_services_lock_;
 
   THREAD_CHECKER(thread_checker_);
 
@@ -0,0 +1,30 @@
+/* Copyright (c) 2021 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/components/brave_shields/browser/ad_block_test_util.h"
+
+#include <string>
+
+#include "net/base/registry_controlled_domains/registry_controlled_domain.h"
+
+namespace brave_shields {
+
+void TestDomainResolver(const char* host, uint32_t* start, uint32_t* end) {
+  const std::string host_str(host);
+  const std::string domain =
+      net::registry_controlled_domains::GetDomainAndRegistry(
+          host_str,
+          net::registry_controlled_domains::INCLUDE_PRIVATE_REGISTRIES);
+  const size_t match = host_str.rfind(domain);
+  if (match != std::string::npos) {
+    *start = match;
+    *end = match + domain.length();
+  } else {
+    *start = 0;
+    *end = host_str.length();
+  }
+}
+
+}  // namespace brave_shields
@@ -0,0 +1,20 @@
+/* Copyright (c) 2021 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_AD_BLOCK_TEST_UTIL_H_
+#define BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_AD_BLOCK_TEST_UTIL_H_
+
+#include <stdint.h>
+
+namespace brave_shields {
+
+// Domain resolver for adblock-rust in tests that use the engines without
+// AdBlockService, which otherwise installs the same resolver. Pass it to
+// adblock::SetDomainResolver().
+void TestDomainResolver(const char* host, uint32_t* start, uint32_t* end);
+
+}  // namespace brave_shields
+
+#endif  // BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_AD_BLOCK_TEST_UTIL_H_
@@ -12,6 +12,45 @@ namespace brave_shields {
 
 using ::testing::_;
 
+namespace {
+
+std::vector<std::string> StringsFromValue(const base::Value* list) {
+  std::vector<std::string> strings;
+  if (list) {
+    for (const auto& item : list->GetList())
+      strings.push_back(item.GetString());
+  }
+  return strings;
+}
+
+// Reads resources in the layout of adblock-rust's JSON serialization.
+cosmetic_filters::mojom::CosmeticResourcesPtr ResourcesFromJSON(
+    const std::string& json) {
+  absl::optional<base::Value> value = base::JSONReader::Read(json);
+  if (!value || !value->is_dict())
+    return nullptr;
+
+  auto resources = cosmetic_filters::mojom::CosmeticResources::New();
+  resources->hide_selectors =
+      StringsFromValue(value->FindListKey("hide_selectors"));
+  resources->force_hide_selectors =
+      StringsFromValue(value->FindListKey("force_hide_selectors"));
+  const base::Value* style_selectors = value->FindDictKey("style_selectors");
+  if (style_selectors) {
+    for (const auto item : style_selectors->DictItems())
+      resources->style_selectors[item.first] = StringsFromValue(&item.second);
+  }
+  resources->exceptions = StringsFromValue(value->FindListKey("exceptions"));
+  const std::string* injected_script =
+      value->FindStringKey("injected_script");
+  if (injected_script)
+    resources->injected_script = *injected_script;
+  resources->generichide = value->FindBoolKey("generichide").value_or(false);
+  return resources;
+}
+
+}  // namespace
+
 class CosmeticResourceMergeTest : public testing::Test {
  public:
   CosmeticResourceMergeTest() {}
@@ -22,19 +61,20 @@ class CosmeticResourceMergeTest : public testing::Test {
           const std::string& b,
           bool force_hide,
           const std::string& expected) {
-    absl::optional<base::Value> a_val = base::JSONReader::Read(a);
+    cosmetic_filters::mojom::CosmeticResourcesPtr a_val = ResourcesFromJSON(a);
     ASSERT_TRUE(a_val);
 
-    absl::optional<base::Value> b_val = base::JSONReader::Read(b);
+    cosmetic_filters::mojom::CosmeticResourcesPtr b_val = ResourcesFromJSON(b);
     ASSERT_TRUE(b_val);
 
-    const absl::optional<base::Value> expected_val =
-        base::JSONReader::Read(expected);
+    const cosmetic_filters::mojom::CosmeticResourcesPtr expected_val =
+        ResourcesFromJSON(expected);
     ASSERT_TRUE(expected_val);
 
-    MergeResourcesInto(std::move(b_val.value()), &*a_val, force_hide);
+    MergeResourcesInto(std::move(b_val), a_val.get(), force_hide);
 
-    ASSERT_EQ(*a_val, *expected_val);
+    ASSERT_TRUE(a_val->Equals(*expected_val))
+        << CosmeticResourcesToValue(*a_val);
   }
 
  protected:
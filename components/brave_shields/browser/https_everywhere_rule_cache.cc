@@ -0,0 +1,113 @@
+/* Copyright (c) 2021 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/components/brave_shields/browser/https_everywhere_rule_cache.h"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+#include "base/check_op.h"
+#include "brave/components/brave_shields/browser/https_everywhere_rules.h"
+
+namespace brave_shields {
+
+namespace {
+
+// Number of lookups a shard sees before deciding whether to grow.
+constexpr size_t kGrowthWindow = 256;
+
+}  // namespace
+
+constexpr size_t HTTPSERuleCache::kShardCount;
+
+HTTPSERuleCache::Shard::Shard() : entries(Entries::NO_AUTO_EVICT) {}
+
+HTTPSERuleCache::Shard::~Shard() = default;
+
+HTTPSERuleCache::HTTPSERuleCache(size_t min_shard_capacity,
+                                 size_t max_shard_capacity)
+    : min_shard_capacity_(min_shard_capacity),
+      max_shard_capacity_(max_shard_capacity) {
+  DCHECK_GT(min_shard_capacity_, 0u);
+  DCHECK_LE(min_shard_capacity_, max_shard_capacity_);
+  for (Shard& shard : shards_) {
+    base::AutoLock lock(shard.lock);
+    shard.capacity = min_shard_capacity_;
+  }
+}
+
+HTTPSERuleCache::~HTTPSERuleCache() = default;
+
+scoped_refptr<const HTTPSERules> HTTPSERuleCache::Get(
+    const std::string& host) {
+  Shard& shard = GetShard(host);
+  base::AutoLock lock(shard.lock);
+  ++shard.lookups;
+  auto it = shard.entries.Get(host);
+  if (it != shard.entries.end())
+    return it->second;
+
+  if (shard.entries.size() >= shard.capacity)
+    ++shard.full_misses;
+  MaybeGrow(&shard);
+  return nullptr;
+}
+
+void HTTPSERuleCache::Put(const std::string& host,
+                          scoped_refptr<const HTTPSERules> rules) {
+  Shard& shard = GetShard(host);
+  base::AutoLock lock(shard.lock);
+  shard.entries.Put(host, std::move(rules));
+  if (shard.entries.size() > shard.capacity)
+    shard.entries.ShrinkToSize(shard.capacity);
+}
+
+void HTTPSERuleCache::Clear() {
+  for (Shard& shard : shards_) {
+    base::AutoLock lock(shard.lock);
+    shard.entries.Clear();
+    shard.capacity = min_shard_capacity_;
+    shard.lookups = 0;
+    shard.full_misses = 0;
+  }
+}
+
+size_t HTTPSERuleCache::size() {
+  size_t size = 0;
+  for (Shard& shard : shards_) {
+    base::AutoLock lock(shard.lock);
+    size += shard.entries.size();
+  }
+  return size;
+}
+
+size_t HTTPSERuleCache::capacity() {
+  size_t capacity = 0;
+  for (Shard& shard : shards_) {
+    base::AutoLock lock(shard.lock);
+    capacity += shard.capacity;
+  }
+  return capacity;
+}
+
+HTTPSERuleCache::Shard& HTTPSERuleCache::GetShard(const std::string& host) {
+  return shards_[std::hash<std::string>()(host) % kShardCount];
+}
+
+void HTTPSERuleCache::MaybeGrow(Shard* shard) {
+  if (shard->lookups < kGrowthWindow)
+    return;
+  // More than a quarter of the lookups missed on a full shard, so the working
+  // set does not fit.
+  if (shard->full_misses * 4 > shard->lookups &&
+      shard->capacity < max_shard_capacity_) {
+    shard->capacity = std::min(shard->capacity * 2, max_shard_capacity_);
+  }
+  shard->lookups = 0;
+  shard->full_misses = 0;
+}
+
+}  // namespace brave_shields
@@ -0,0 +1,80 @@
+/* Copyright (c) 2021 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_HTTPS_EVERYWHERE_RULE_CACHE_H_
+#define BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_HTTPS_EVERYWHERE_RULE_CACHE_H_
+
+#include <stddef.h>
+
+#include <array>
+#include <string>
+
+#include "base/containers/mru_cache.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
+
+namespace brave_shields {
+
+class HTTPSERules;
+
+// Caches the compiled HTTPS Everywhere rules of recently seen hosts, including
+// hosts that no rule applies to, so that the rule database is only read once
+// per host.
+//
+// Entries are spread over independently locked shards by host, so lookups from
+// different threads rarely wait on each other. Each shard starts small and
+// doubles its capacity, up to |max_shard_capacity|, while it keeps missing on
+// hosts it had to evict.
+class HTTPSERuleCache {
+ public:
+  static constexpr size_t kShardCount = 16;
+
+  HTTPSERuleCache(size_t min_shard_capacity = 64,
+                  size_t max_shard_capacity = 1024);
+  ~HTTPSERuleCache();
+
+  // Returns null if |host| is not cached. May be called on any thread.
+  scoped_refptr<const HTTPSERules> Get(const std::string& host);
+  // May be called on any thread.
+  void Put(const std::string& host, scoped_refptr<const HTTPSERules> rules);
+  // Drops all entries and shrinks the shards back to their initial capacity.
+  void Clear();
+
+  size_t size();
+  size_t capacity();
+
+ private:
+  using Entries =
+      base::HashingMRUCache<std::string, scoped_refptr<const HTTPSERules>>;
+
+  struct Shard {
+    Shard();
+    ~Shard();
+
+    base::Lock lock;
+    Entries entries GUARDED_BY(lock);
+    size_t capacity GUARDED_BY(lock) = 0;
+    // Lookups since the capacity last changed, and how many of them missed
+    // while the shard was full.
+    size_t lookups GUARDED_BY(lock) = 0;
+    size_t full_misses GUARDED_BY(lock) = 0;
+  };
+
+  Shard& GetShard(const std::string& host);
+  // Grows |shard| if it missed too often while full.
+  void MaybeGrow(Shard* shard) EXCLUSIVE_LOCKS_REQUIRED(shard->lock);
+
+  const size_t min_shard_capacity_;
+  const size_t max_shard_capacity_;
+  std::array<Shard, kShardCount> shards_;
+
+  HTTPSERuleCache(const HTTPSERuleCache&) = delete;
+  HTTPSERuleCache& operator=(const HTTPSERuleCache&) = delete;
+};
+
+}  // namespace brave_shields
+
+#endif  // BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_HTTPS_EVERYWHERE_RULE_CACHE_H_
@@ -0,0 +1,113 @@
+/* Copyright (c) 2021 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/components/brave_shields/browser/https_everywhere_rule_cache.h"
+
+#include <string>
+
+#include "base/strings/string_number_conversions.h"
+#include "brave/components/brave_shields/browser/https_everywhere_rules.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace brave_shields {
+
+namespace {
+
+constexpr char kUpgradeRule[] = R"([{"r": [{"d": 1}]}])";
+
+std::string HostForIndex(int i) {
+  return "host" + base::NumberToString(i) + ".example.com";
+}
+
+}  // namespace
+
+TEST(HTTPSERuleCacheTest, GetPutClear) {
+  HTTPSERuleCache cache;
+  EXPECT_FALSE(cache.Get("example.com"));
+
+  cache.Put("example.com", HTTPSERules::Compile({kUpgradeRule}));
+  cache.Put("no-rules.example.com", HTTPSERules::Compile({}));
+
+  scoped_refptr<const HTTPSERules> rules = cache.Get("example.com");
+  ASSERT_TRUE(rules);
+  EXPECT_EQ(rules->Apply("http://example.com/"), "https://example.com/");
+  // Hosts without rules are cached too.
+  rules = cache.Get("no-rules.example.com");
+  ASSERT_TRUE(rules);
+  EXPECT_TRUE(rules->empty());
+
+  cache.Clear();
+  EXPECT_FALSE(cache.Get("example.com"));
+  EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST(HTTPSERuleCacheTest, EvictsLeastRecentlyUsedPerShard) {
+  HTTPSERuleCache cache(2, 2);
+  const scoped_refptr<HTTPSERules> rules = HTTPSERules::Compile({});
+  for (int i = 0; i < 1000; ++i)
+    cache.Put(HostForIndex(i), rules);
+  EXPECT_EQ(cache.size(), 2 * HTTPSERuleCache::kShardCount);
+  // The most recent host is always kept.
+  EXPECT_TRUE(cache.Get(HostForIndex(999)));
+  EXPECT_FALSE(cache.Get(HostForIndex(0)));
+}
+
+TEST(HTTPSERuleCacheTest, GrowsWhileMissingWhenFull) {
+  HTTPSERuleCache cache(2, 64);
+  EXPECT_EQ(cache.capacity(), 2 * HTTPSERuleCache::kShardCount);
+
+  // A working set larger than the cache keeps missing, so the shards grow
+  // until it fits.
+  const scoped_refptr<HTTPSERules> rules = HTTPSERules::Compile({});
+  for (int round = 0; round < 200; ++round) {
+    for (int i = 0; i < 256; ++i) {
+      if (!cache.Get(HostForIndex(i)))
+        cache.Put(HostForIndex(i), rules);
+    }
+  }
+  EXPECT_GE(cache.capacity(), 256u);
+  EXPECT_LE(cache.capacity(), 64 * HTTPSERuleCache::kShardCount);
+  EXPECT_EQ(cache.size(), 256u);
+
+  cache.Clear();
+  EXPECT_EQ(cache.capacity(), 2 * HTTPSERuleCache::kShardCount);
+}
+
+TEST(HTTPSERulesTest, AppliesRulesInDomainOrder) {
+  scoped_refptr<HTTPSERules> rules = HTTPSERules::Compile({
+      // The host's own rules only rewrite /secure paths, and exclude /plain.
+      R"([{"e": [{"p": "^http://www\\.example\\.com/plain.*"}],
+           "r": [{"f": "^http://www\\.example\\.com/secure/(.*)",
+                  "t": "https://secure.example.com/$1"}]}])",
+      "not json",
+      // The wildcard domain upgrades everything else.
+      kUpgradeRule,
+  });
+  ASSERT_FALSE(rules->empty());
+
+  EXPECT_EQ(rules->Apply("http://www.example.com/secure/a?b=c"),
+            "https://secure.example.com/a?b=c");
+  EXPECT_EQ(rules->Apply("http://www.example.com/other"),
+            "https://www.example.com/other");
+  // An exclusion only ends the lookup for its own domain.
+  EXPECT_EQ(rules->Apply("http://www.example.com/plain"),
+            "https://www.example.com/plain");
+}
+
+TEST(HTTPSERulesTest, NoMatchingRule) {
+  scoped_refptr<HTTPSERules> rules = HTTPSERules::Compile({
+      R"([{"r": [{"f": "^http://a\\.example\\.com/",
+                 "t": "https://a.example.com/"}]}])",
+  });
+  EXPECT_EQ(rules->Apply("http://b.example.com/"), "");
+
+  // A rule set without rules ends the lookup for its domain.
+  rules = HTTPSERules::Compile({R"([{"e": []}, {"r": [{"d": 1}]}])"});
+  EXPECT_EQ(rules->Apply("http://b.example.com/"), "");
+
+  EXPECT_TRUE(HTTPSERules::Compile({"not json"})->empty());
+}
+
+}  // namespace brave_shields
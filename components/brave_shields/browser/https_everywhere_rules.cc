@@ -0,0 +1,167 @@
+/* Copyright (c) 2021 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/components/brave_shields/browser/https_everywhere_rules.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "base/json/json_reader.h"
+#include "base/values.h"
+#include "third_party/re2/src/re2/re2.h"
+
+namespace brave_shields {
+
+namespace {
+
+// HTTPS Everywhere uses $1 style back references, RE2 uses \1.
+std::string CorrectRuleForRE2(const std::string& rule) {
+  std::string corrected(rule);
+  std::replace(corrected.begin(), corrected.end(), '$', '\\');
+  return corrected;
+}
+
+}  // namespace
+
+HTTPSERuleData::HTTPSERuleData() = default;
+HTTPSERuleData::HTTPSERuleData(const HTTPSERuleData& other) = default;
+HTTPSERuleData::HTTPSERuleData(HTTPSERuleData&& other) = default;
+HTTPSERuleData::~HTTPSERuleData() = default;
+
+HTTPSERuleSetData::HTTPSERuleSetData() = default;
+HTTPSERuleSetData::HTTPSERuleSetData(const HTTPSERuleSetData& other) = default;
+HTTPSERuleSetData::HTTPSERuleSetData(HTTPSERuleSetData&& other) = default;
+HTTPSERuleSetData::~HTTPSERuleSetData() = default;
+
+bool ParseHTTPSEDomainRuleSets(const std::string& json,
+                               HTTPSEDomainRuleSets* rule_sets) {
+  absl::optional<base::Value> value = base::JSONReader::Read(json);
+  if (!value || !value->is_list())
+    return false;
+
+  rule_sets->clear();
+  for (const base::Value& rule_set_value : value->GetList()) {
+    if (!rule_set_value.is_dict())
+      continue;
+    HTTPSERuleSetData rule_set;
+
+    const base::Value* exclusions = rule_set_value.FindListKey("e");
+    if (exclusions) {
+      for (const base::Value& exclusion : exclusions->GetList()) {
+        if (!exclusion.is_dict())
+          continue;
+        const std::string* pattern = exclusion.FindStringKey("p");
+        if (pattern)
+          rule_set.exclusions.push_back(CorrectRuleForRE2(*pattern));
+      }
+    }
+
+    const base::Value* rules = rule_set_value.FindListKey("r");
+    rule_set.has_rules = !!rules;
+    if (rules) {
+      for (const base::Value& rule_value : rules->GetList()) {
+        if (!rule_value.is_dict())
+          continue;
+        HTTPSERuleData rule;
+        if (rule_value.FindKey("d")) {
+          rule.upgrade_scheme = true;
+        } else {
+          const std::string* from = rule_value.FindStringKey("f");
+          const std::string* to = rule_value.FindStringKey("t");
+          if (!from || !to)
+            continue;
+          rule.from = *from;
+          rule.to = CorrectRuleForRE2(*to);
+        }
+        rule_set.rules.push_back(std::move(rule));
+      }
+    }
+    rule_sets->push_back(std::move(rule_set));
+  }
+  return true;
+}
+
+HTTPSERules::Rule::Rule() = default;
+HTTPSERules::Rule::Rule(Rule&& other) = default;
+HTTPSERules::Rule::~Rule() = default;
+
+HTTPSERules::RuleSet::RuleSet() = default;
+HTTPSERules::RuleSet::RuleSet(RuleSet&& other) = default;
+HTTPSERules::RuleSet::~RuleSet() = default;
+
+HTTPSERules::HTTPSERules() = default;
+HTTPSERules::~HTTPSERules() = default;
+
+// static
+scoped_refptr<HTTPSERules> HTTPSERules::Compile(
+    const std::vector<HTTPSEDomainRuleSets>& domains) {
+  scoped_refptr<HTTPSERules> compiled = base::WrapRefCounted(new HTTPSERules);
+  for (const HTTPSEDomainRuleSets& domain : domains) {
+    DomainRules domain_rules;
+    for (const HTTPSERuleSetData& rule_set_data : domain) {
+      RuleSet rule_set;
+      for (const std::string& exclusion : rule_set_data.exclusions)
+        rule_set.exclusions.push_back(std::make_unique<re2::RE2>(exclusion));
+      rule_set.has_rules = rule_set_data.has_rules;
+      for (const HTTPSERuleData& rule_data : rule_set_data.rules) {
+        Rule rule;
+        rule.upgrade_scheme = rule_data.upgrade_scheme;
+        if (!rule.upgrade_scheme) {
+          rule.from = std::make_unique<re2::RE2>(rule_data.from);
+          rule.to = rule_data.to;
+        }
+        rule_set.rules.push_back(std::move(rule));
+      }
+      domain_rules.push_back(std::move(rule_set));
+    }
+    compiled->domains_.push_back(std::move(domain_rules));
+  }
+  return compiled;
+}
+
+// static
+scoped_refptr<HTTPSERules> HTTPSERules::Compile(
+    const std::vector<std::string>& json_domains) {
+  std::vector<HTTPSEDomainRuleSets> domains;
+  for (const std::string& json : json_domains) {
+    HTTPSEDomainRuleSets rule_sets;
+    if (ParseHTTPSEDomainRuleSets(json, &rule_sets))
+      domains.push_back(std::move(rule_sets));
+  }
+  return Compile(domains);
+}
+
+std::string HTTPSERules::Apply(const std::string& url) const {
+  for (const DomainRules& domain_rules : domains_) {
+    std::string new_url = ApplyDomainRules(domain_rules, url);
+    if (!new_url.empty())
+      return new_url;
+  }
+  return std::string();
+}
+
+// static
+std::string HTTPSERules::ApplyDomainRules(const DomainRules& domain_rules,
+                                          const std::string& url) {
+  for (const RuleSet& rule_set : domain_rules) {
+    for (const auto& exclusion : rule_set.exclusions) {
+      if (re2::RE2::FullMatch(url, *exclusion))
+        return std::string();
+    }
+    if (!rule_set.has_rules)
+      return std::string();
+
+    for (const Rule& rule : rule_set.rules) {
+      std::string new_url(url);
+      if (rule.upgrade_scheme)
+        return new_url.insert(4, "s");
+      if (re2::RE2::Replace(&new_url, *rule.from, rule.to) && new_url != url)
+        return new_url;
+    }
+  }
+  return std::string();
+}
+
+}  // namespace brave_shields
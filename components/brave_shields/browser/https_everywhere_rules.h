@@ -0,0 +1,117 @@
+/* Copyright (c) 2021 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_HTTPS_EVERYWHERE_RULES_H_
+#define BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_HTTPS_EVERYWHERE_RULES_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/memory/ref_counted.h"
+
+namespace re2 {
+class RE2;
+}  // namespace re2
+
+namespace brave_shields {
+
+// One HTTPS Everywhere rewrite rule, before its regex is built.
+struct HTTPSERuleData {
+  HTTPSERuleData();
+  HTTPSERuleData(const HTTPSERuleData& other);
+  HTTPSERuleData(HTTPSERuleData&& other);
+  ~HTTPSERuleData();
+
+  // Set for rules that only upgrade the scheme, in which case |from| and |to|
+  // are empty.
+  bool upgrade_scheme = false;
+  std::string from;
+  // Uses RE2 style \1 back references.
+  std::string to;
+};
+
+// One HTTPS Everywhere rule set, before its regexes are built.
+struct HTTPSERuleSetData {
+  HTTPSERuleSetData();
+  HTTPSERuleSetData(const HTTPSERuleSetData& other);
+  HTTPSERuleSetData(HTTPSERuleSetData&& other);
+  ~HTTPSERuleSetData();
+
+  std::vector<std::string> exclusions;
+  // False when the rule set has no rule list, which ends the lookup for its
+  // domain.
+  bool has_rules = false;
+  std::vector<HTTPSERuleData> rules;
+};
+
+// The rule sets stored for one lookup domain.
+using HTTPSEDomainRuleSets = std::vector<HTTPSERuleSetData>;
+
+// Parses the JSON value stored for a lookup domain in the rule database.
+// Returns false if it does not parse.
+bool ParseHTTPSEDomainRuleSets(const std::string& json,
+                               HTTPSEDomainRuleSets* rule_sets);
+
+// The HTTPS Everywhere rule sets that apply to one host, compiled once so that
+// URLs on the host can be rewritten without parsing or building regexes.
+// Immutable once compiled, so it may be used from any thread.
+class HTTPSERules : public base::RefCountedThreadSafe<HTTPSERules> {
+ public:
+  // |domains| are the rule sets of each of the host's lookup domains, most
+  // specific first.
+  static scoped_refptr<HTTPSERules> Compile(
+      const std::vector<HTTPSEDomainRuleSets>& domains);
+  // Same as above, from the JSON values stored in the rule database. Values
+  // that do not parse are skipped.
+  static scoped_refptr<HTTPSERules> Compile(
+      const std::vector<std::string>& json_domains);
+
+  // Returns the HTTPS URL for |url|, or an empty string if no rule applies.
+  std::string Apply(const std::string& url) const;
+
+  // Whether no rule set applies to the host at all.
+  bool empty() const { return domains_.empty(); }
+
+ private:
+  friend class base::RefCountedThreadSafe<HTTPSERules>;
+
+  struct Rule {
+    Rule();
+    Rule(Rule&& other);
+    ~Rule();
+
+    bool upgrade_scheme = false;
+    std::unique_ptr<re2::RE2> from;
+    std::string to;
+  };
+
+  struct RuleSet {
+    RuleSet();
+    RuleSet(RuleSet&& other);
+    ~RuleSet();
+
+    std::vector<std::unique_ptr<re2::RE2>> exclusions;
+    bool has_rules = false;
+    std::vector<Rule> rules;
+  };
+
+  using DomainRules = std::vector<RuleSet>;
+
+  HTTPSERules();
+  ~HTTPSERules();
+
+  static std::string ApplyDomainRules(const DomainRules& domain_rules,
+                                      const std::string& url);
+
+  std::vector<DomainRules> domains_;
+
+  HTTPSERules(const HTTPSERules&) = delete;
+  HTTPSERules& operator=(const HTTPSERules&) = delete;
+};
+
+}  // namespace brave_shields
+
+#endif  // BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_HTTPS_EVERYWHERE_RULES_H_
@@ -0,0 +1,395 @@
+/* Copyright (c) 2021 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/components/brave_shields/browser/https_everywhere_ruleset.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/important_file_writer.h"
+#include "base/memory/ptr_util.h"
+#include "base/numerics/safe_conversions.h"
+#include "base/strings/string_split.h"
+#include "third_party/leveldatabase/src/include/leveldb/db.h"
+
+namespace brave_shields {
+
+namespace {
+
+// "HTSE"
+constexpr uint32_t kMagic = 0x45535448;
+// Bump when the layout below changes, so that old files are rebuilt.
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kNone = std::numeric_limits<uint32_t>::max();
+
+// Splits a host or a database key into its labels. Like the std::getline loop
+// the lookup domains were made with, a trailing dot adds no empty label.
+std::vector<std::string> SplitLabels(const std::string& domain) {
+  std::vector<std::string> labels = base::SplitString(
+      domain, ".", base::KEEP_WHITESPACE, base::SPLIT_WANT_ALL);
+  if (!labels.empty() && labels.back().empty())
+    labels.pop_back();
+  return labels;
+}
+
+template <typename T>
+void AppendSection(const std::vector<T>& items, std::string* out) {
+  out->append(reinterpret_cast<const char*>(items.data()),
+              items.size() * sizeof(T));
+}
+
+}  // namespace
+
+// The file is a Header followed by the sections it points to. Strings are
+// stored once in the strings section and referenced by offset and length.
+// Every other section is an array of the fixed size, 4-byte aligned structs
+// below, so it can be used straight from the mapping.
+struct HTTPSERuleset::Section {
+  uint32_t offset;
+  uint32_t count;
+};
+
+struct HTTPSERuleset::StringRef {
+  uint32_t offset;
+  uint32_t length;
+};
+
+struct HTTPSERuleset::Header {
+  uint32_t magic;
+  uint32_t version;
+  Section nodes;
+  Section domains;
+  Section rule_sets;
+  Section exclusions;
+  Section rules;
+  Section strings;
+};
+
+// A trie node per reversed domain label. Node 0 is the root, and the children
+// of a node are contiguous and sorted by label.
+struct HTTPSERuleset::Node {
+  StringRef label;
+  uint32_t first_child;
+  uint32_t child_count;
+  // The rule sets stored for the domain itself, and for "<domain>.*".
+  uint32_t exact_domain;
+  uint32_t wildcard_domain;
+};
+
+struct HTTPSERuleset::Domain {
+  uint32_t first_rule_set;
+  uint32_t rule_set_count;
+};
+
+struct HTTPSERuleset::RuleSet {
+  uint32_t first_exclusion;
+  uint32_t exclusion_count;
+  uint32_t has_rules;
+  uint32_t first_rule;
+  uint32_t rule_count;
+};
+
+struct HTTPSERuleset::Rule {
+  uint32_t upgrade_scheme;
+  StringRef from;
+  StringRef to;
+};
+
+HTTPSERuleset::HTTPSERuleset() = default;
+
+HTTPSERuleset::~HTTPSERuleset() = default;
+
+// static
+bool HTTPSERuleset::Build(leveldb::DB* db, const base::FilePath& path) {
+  std::map<std::string, std::string> entries;
+  std::unique_ptr<leveldb::Iterator> it(
+      db->NewIterator(leveldb::ReadOptions()));
+  for (it->SeekToFirst(); it->Valid(); it->Next())
+    entries.emplace(it->key().ToString(), it->value().ToString());
+  if (!it->status().ok())
+    return false;
+
+  return base::ImportantFileWriter::WriteFileAtomically(path,
+                                                        Serialize(entries));
+}
+
+// static
+std::string HTTPSERuleset::Serialize(
+    const std::map<std::string, std::string>& db) {
+  struct BuilderNode {
+    std::map<std::string, std::unique_ptr<BuilderNode>> children;
+    uint32_t exact_domain = kNone;
+    uint32_t wildcard_domain = kNone;
+  };
+
+  BuilderNode root;
+  std::vector<Domain> domains;
+  std::vector<RuleSet> rule_sets;
+  std::vector<StringRef> exclusions;
+  std::vector<Rule> rules;
+  std::string strings;
+  auto add_string = [&strings](const std::string& value) {
+    const StringRef ref = {base::checked_cast<uint32_t>(strings.size()),
+                           base::checked_cast<uint32_t>(value.size())};
+    strings.append(value);
+    return ref;
+  };
+
+  for (const auto& entry : db) {
+    HTTPSEDomainRuleSets parsed;
+    if (!ParseHTTPSEDomainRuleSets(entry.second, &parsed))
+      continue;
+    std::vector<std::string> labels = SplitLabels(entry.first);
+    const bool wildcard = labels.size() > 1 && labels.back() == "*";
+    if (wildcard)
+      labels.pop_back();
+    if (labels.empty())
+      continue;
+
+    const Domain domain = {base::checked_cast<uint32_t>(rule_sets.size()),
+                           base::checked_cast<uint32_t>(parsed.size())};
+    for (const HTTPSERuleSetData& parsed_rule_set : parsed) {
+      const RuleSet rule_set = {
+          base::checked_cast<uint32_t>(exclusions.size()),
+          base::checked_cast<uint32_t>(parsed_rule_set.exclusions.size()),
+          parsed_rule_set.has_rules,
+          base::checked_cast<uint32_t>(rules.size()),
+          base::checked_cast<uint32_t>(parsed_rule_set.rules.size())};
+      for (const std::string& exclusion : parsed_rule_set.exclusions)
+        exclusions.push_back(add_string(exclusion));
+      for (const HTTPSERuleData& rule : parsed_rule_set.rules) {
+        rules.push_back(
+            {rule.upgrade_scheme, add_string(rule.from), add_string(rule.to)});
+      }
+      rule_sets.push_back(rule_set);
+    }
+    const uint32_t domain_index = base::checked_cast<uint32_t>(domains.size());
+    domains.push_back(domain);
+
+    BuilderNode* node = &root;
+    for (const std::string& label : labels) {
+      std::unique_ptr<BuilderNode>& child = node->children[label];
+      if (!child)
+        child = std::make_unique<BuilderNode>();
+      node = child.get();
+    }
+    if (wildcard)
+      node->wildcard_domain = domain_index;
+    else
+      node->exact_domain = domain_index;
+  }
+
+  // Lays the trie out breadth first, which keeps the children of each node
+  // contiguous and in label order.
+  std::vector<std::pair<std::string, const BuilderNode*>> order = {
+      {std::string(), &root}};
+  std::vector<Node> nodes;
+  for (size_t i = 0; i < order.size(); ++i) {
+    const BuilderNode* builder_node = order[i].second;
+    nodes.push_back(
+        {add_string(order[i].first),
+         base::checked_cast<uint32_t>(order.size()),
+         base::checked_cast<uint32_t>(builder_node->children.size()),
+         builder_node->exact_domain, builder_node->wildcard_domain});
+    for (const auto& child : builder_node->children)
+      order.emplace_back(child.first, child.second.get());
+  }
+
+  Header header = {};
+  header.magic = kMagic;
+  header.version = kVersion;
+  size_t offset = sizeof(Header);
+  auto place = [&offset](Section* section, size_t count, size_t size) {
+    section->offset = base::checked_cast<uint32_t>(offset);
+    section->count = base::checked_cast<uint32_t>(count);
+    offset += count * size;
+  };
+  place(&header.nodes, nodes.size(), sizeof(Node));
+  place(&header.domains, domains.size(), sizeof(Domain));
+  place(&header.rule_sets, rule_sets.size(), sizeof(RuleSet));
+  place(&header.exclusions, exclusions.size(), sizeof(StringRef));
+  place(&header.rules, rules.size(), sizeof(Rule));
+  place(&header.strings, strings.size(), 1);
+
+  std::string out;
+  out.reserve(offset);
+  out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  AppendSection(nodes, &out);
+  AppendSection(domains, &out);
+  AppendSection(rule_sets, &out);
+  AppendSection(exclusions, &out);
+  AppendSection(rules, &out);
+  out.append(strings);
+  return out;
+}
+
+// static
+std::unique_ptr<HTTPSERuleset> HTTPSERuleset::Open(
+    const base::FilePath& path) {
+  if (!base::PathExists(path))
+    return nullptr;
+  std::unique_ptr<HTTPSERuleset> ruleset = base::WrapUnique(new HTTPSERuleset);
+  if (!ruleset->file_.Initialize(path) || !ruleset->Validate())
+    return nullptr;
+  return ruleset;
+}
+
+scoped_refptr<HTTPSERules> HTTPSERuleset::GetRules(
+    const std::string& host) const {
+  const std::vector<std::string> labels = SplitLabels(host);
+  std::vector<HTTPSEDomainRuleSets> domains;
+  auto add_domain = [this, &domains](uint32_t index) {
+    HTTPSEDomainRuleSets rule_sets;
+    if (index != kNone && ReadDomain(index, &rule_sets))
+      domains.push_back(std::move(rule_sets));
+  };
+
+  // Top level domains never have rules of their own.
+  const size_t label_count = labels.size();
+  if (label_count >= 2) {
+    // |path[depth]| is the node of the last |depth| labels of |host|.
+    std::vector<const Node*> path = {GetSection<Node>(header_->nodes)};
+    for (auto label = labels.rbegin(); label != labels.rend(); ++label) {
+      const Node* child = FindChild(*path.back(), *label);
+      if (!child)
+        break;
+      path.push_back(child);
+    }
+
+    // Same order as the database lookups: the host itself, then each of its
+    // parent domains as a wildcard, down to the registrable domain.
+    if (path.size() == label_count + 1)
+      add_domain(path[label_count]->exact_domain);
+    for (size_t depth = std::min(label_count - 1, path.size() - 1); depth >= 2;
+         --depth) {
+      add_domain(path[depth]->wildcard_domain);
+    }
+  }
+
+  return HTTPSERules::Compile(domains);
+}
+
+bool HTTPSERuleset::Validate() {
+  if (file_.length() < sizeof(Header))
+    return false;
+  const Header* header = reinterpret_cast<const Header*>(file_.data());
+  if (header->magic != kMagic || header->version != kVersion)
+    return false;
+
+  auto valid = [this](const Section& section, size_t size, size_t alignment) {
+    return section.offset % alignment == 0 &&
+           section.offset <= file_.length() &&
+           (file_.length() - section.offset) / size >= section.count;
+  };
+  if (!valid(header->nodes, sizeof(Node), 4) || header->nodes.count == 0 ||
+      !valid(header->domains, sizeof(Domain), 4) ||
+      !valid(header->rule_sets, sizeof(RuleSet), 4) ||
+      !valid(header->exclusions, sizeof(StringRef), 4) ||
+      !valid(header->rules, sizeof(Rule), 4) ||
+      !valid(header->strings, 1, 1)) {
+    return false;
+  }
+
+  header_ = header;
+  return true;
+}
+
+template <typename T>
+const T* HTTPSERuleset::GetSection(const Section& section) const {
+  return reinterpret_cast<const T*>(file_.data() + section.offset);
+}
+
+const HTTPSERuleset::Node* HTTPSERuleset::FindChild(
+    const Node& node,
+    base::StringPiece label) const {
+  if (static_cast<uint64_t>(node.first_child) + node.child_count >
+      header_->nodes.count) {
+    return nullptr;
+  }
+  const Node* first = GetSection<Node>(header_->nodes) + node.first_child;
+  const Node* last = first + node.child_count;
+  const Node* child =
+      std::lower_bound(first, last, label,
+                       [this](const Node& candidate, base::StringPiece value) {
+                         base::StringPiece candidate_label;
+                         GetString(candidate.label, &candidate_label);
+                         return candidate_label < value;
+                       });
+  base::StringPiece child_label;
+  if (child == last || !GetString(child->label, &child_label) ||
+      child_label != label) {
+    return nullptr;
+  }
+  return child;
+}
+
+bool HTTPSERuleset::GetString(const StringRef& ref,
+                              base::StringPiece* out) const {
+  if (static_cast<uint64_t>(ref.offset) + ref.length >
+      header_->strings.count) {
+    return false;
+  }
+  *out = base::StringPiece(
+      reinterpret_cast<const char*>(file_.data()) + header_->strings.offset +
+          ref.offset,
+      ref.length);
+  return true;
+}
+
+bool HTTPSERuleset::ReadDomain(uint32_t index,
+                               HTTPSEDomainRuleSets* rule_sets) const {
+  if (index >= header_->domains.count)
+    return false;
+  const Domain& domain = GetSection<Domain>(header_->domains)[index];
+  if (static_cast<uint64_t>(domain.first_rule_set) + domain.rule_set_count >
+      header_->rule_sets.count) {
+    return false;
+  }
+
+  const RuleSet* rule_set = GetSection<RuleSet>(header_->rule_sets) +
+                            domain.first_rule_set;
+  for (uint32_t i = 0; i < domain.rule_set_count; ++i, ++rule_set) {
+    if (static_cast<uint64_t>(rule_set->first_exclusion) +
+                rule_set->exclusion_count >
+            header_->exclusions.count ||
+        static_cast<uint64_t>(rule_set->first_rule) + rule_set->rule_count >
+            header_->rules.count) {
+      return false;
+    }
+
+    HTTPSERuleSetData data;
+    const StringRef* exclusion =
+        GetSection<StringRef>(header_->exclusions) + rule_set->first_exclusion;
+    for (uint32_t j = 0; j < rule_set->exclusion_count; ++j, ++exclusion) {
+      base::StringPiece pattern;
+      if (!GetString(*exclusion, &pattern))
+        return false;
+      data.exclusions.emplace_back(pattern);
+    }
+
+    data.has_rules = rule_set->has_rules != 0;
+    const Rule* rule =
+        GetSection<Rule>(header_->rules) + rule_set->first_rule;
+    for (uint32_t j = 0; j < rule_set->rule_count; ++j, ++rule) {
+      base::StringPiece from;
+      base::StringPiece to;
+      if (!GetString(rule->from, &from) || !GetString(rule->to, &to))
+        return false;
+      HTTPSERuleData rule_data;
+      rule_data.upgrade_scheme = rule->upgrade_scheme != 0;
+      rule_data.from = std::string(from);
+      rule_data.to = std::string(to);
+      data.rules.push_back(std::move(rule_data));
+    }
+    rule_sets->push_back(std::move(data));
+  }
+  return true;
+}
+
+}  // namespace brave_shields
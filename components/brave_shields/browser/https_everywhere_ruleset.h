@@ -0,0 +1,82 @@
+/* Copyright (c) 2021 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_HTTPS_EVERYWHERE_RULESET_H_
+#define BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_HTTPS_EVERYWHERE_RULESET_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "base/files/memory_mapped_file.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/strings/string_piece.h"
+#include "brave/components/brave_shields/browser/https_everywhere_rules.h"
+
+namespace base {
+class FilePath;
+}  // namespace base
+
+namespace leveldb {
+class DB;
+}  // namespace leveldb
+
+namespace brave_shields {
+
+// A precompiled, memory-mapped form of the HTTPS Everywhere rule database.
+//
+// The database maps reversed lookup domains, like "com.example.www" or
+// "com.example.*", to JSON rule sets. Build() converts it once, when the
+// component is installed, into a file that holds a trie of the reversed domain
+// labels and the already parsed exclusions and rewrite templates. GetRules()
+// then only walks the mapped trie and builds the regexes of the rules it
+// finds, without any JSON parsing or database reads.
+class HTTPSERuleset {
+ public:
+  ~HTTPSERuleset();
+
+  // Converts every rule set of |db| and writes the result to |path|.
+  static bool Build(leveldb::DB* db, const base::FilePath& path);
+  // Same as Build(), from lookup domain to JSON rule set entries, and returns
+  // the file contents.
+  static std::string Serialize(const std::map<std::string, std::string>& db);
+  // Maps the ruleset at |path|. Returns null if the file is missing or is not
+  // a valid ruleset.
+  static std::unique_ptr<HTTPSERuleset> Open(const base::FilePath& path);
+
+  // Returns the compiled rules of every lookup domain of |host|, most specific
+  // first. The result is empty if no rule set applies to |host|.
+  scoped_refptr<HTTPSERules> GetRules(const std::string& host) const;
+
+ private:
+  struct Header;
+  struct Section;
+  struct StringRef;
+  struct Node;
+  struct Domain;
+  struct RuleSet;
+  struct Rule;
+
+  HTTPSERuleset();
+
+  bool Validate();
+  template <typename T>
+  const T* GetSection(const Section& section) const;
+  const Node* FindChild(const Node& node, base::StringPiece label) const;
+  bool GetString(const StringRef& ref, base::StringPiece* out) const;
+  bool ReadDomain(uint32_t index, HTTPSEDomainRuleSets* rule_sets) const;
+
+  base::MemoryMappedFile file_;
+  const Header* header_ = nullptr;
+
+  HTTPSERuleset(const HTTPSERuleset&) = delete;
+  HTTPSERuleset& operator=(const HTTPSERuleset&) = delete;
+};
+
+}  // namespace brave_shields
+
+#endif  // BRAVE_COMPONENTS_BRAVE_SHIELDS_BROWSER_HTTPS_EVERYWHERE_RULESET_H_
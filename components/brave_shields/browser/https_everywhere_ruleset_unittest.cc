@@ -0,0 +1,88 @@
+/* Copyright (c) 2021 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/components/brave_shields/browser/https_everywhere_ruleset.h"
+
+#include <map>
+#include <string>
+
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace brave_shields {
+
+class HTTPSERulesetTest : public testing::Test {
+ protected:
+  void SetUp() override { ASSERT_TRUE(temp_dir_.CreateUniqueTempDir()); }
+
+  std::unique_ptr<HTTPSERuleset> OpenContents(const std::string& contents) {
+    const base::FilePath path = temp_dir_.GetPath().AppendASCII("ruleset");
+    EXPECT_TRUE(base::WriteFile(path, contents));
+    return HTTPSERuleset::Open(path);
+  }
+
+  std::unique_ptr<HTTPSERuleset> OpenDB(
+      const std::map<std::string, std::string>& db) {
+    return OpenContents(HTTPSERuleset::Serialize(db));
+  }
+
+ private:
+  base::ScopedTempDir temp_dir_;
+};
+
+TEST_F(HTTPSERulesetTest, ExactAndWildcardDomains) {
+  std::unique_ptr<HTTPSERuleset> ruleset = OpenDB({
+      {"com.example.www",
+       R"([{"r": [{"f": "^http://www\\.example\\.com/secure/(.*)",
+                   "t": "https://secure.example.com/$1"}]}])"},
+      {"com.example.*", R"([{"r": [{"d": 1}]}])"},
+      {"org.example", R"([{"r": [{"d": 1}]}])"},
+      {"net.broken", "not json"},
+  });
+  ASSERT_TRUE(ruleset);
+
+  // The host's own rules apply first, then the wildcard ones.
+  scoped_refptr<HTTPSERules> rules = ruleset->GetRules("www.example.com");
+  EXPECT_EQ(rules->Apply("http://www.example.com/secure/a"),
+            "https://secure.example.com/a");
+  EXPECT_EQ(rules->Apply("http://www.example.com/b"),
+            "https://www.example.com/b");
+
+  rules = ruleset->GetRules("a.b.example.com");
+  EXPECT_EQ(rules->Apply("http://a.b.example.com/"),
+            "https://a.b.example.com/");
+  // A wildcard does not match the domain itself.
+  EXPECT_TRUE(ruleset->GetRules("example.com")->empty());
+
+  EXPECT_FALSE(ruleset->GetRules("example.org")->empty());
+  EXPECT_TRUE(ruleset->GetRules("www.example.org")->empty());
+  EXPECT_TRUE(ruleset->GetRules("broken.net")->empty());
+  EXPECT_TRUE(ruleset->GetRules("com")->empty());
+  EXPECT_TRUE(ruleset->GetRules("")->empty());
+}
+
+TEST_F(HTTPSERulesetTest, EmptyDatabase) {
+  std::unique_ptr<HTTPSERuleset> ruleset = OpenDB({});
+  ASSERT_TRUE(ruleset);
+  EXPECT_TRUE(ruleset->GetRules("www.example.com")->empty());
+}
+
+TEST_F(HTTPSERulesetTest, RejectsInvalidFiles) {
+  EXPECT_FALSE(OpenContents(""));
+  EXPECT_FALSE(OpenContents("not a ruleset"));
+
+  std::string contents =
+      HTTPSERuleset::Serialize({{"com.example", R"([{"r": [{"d": 1}]}])"}});
+  // Truncated sections.
+  EXPECT_FALSE(OpenContents(contents.substr(0, contents.size() - 1)));
+  // Unknown version.
+  contents[4] ^= 0xff;
+  EXPECT_FALSE(OpenContents(contents));
+
+  EXPECT_FALSE(HTTPSERuleset::Open(base::FilePath()));
+}
+
+}  // namespace brave_shields
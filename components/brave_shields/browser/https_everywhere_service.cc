@@ -12,20 +12,20 @@
 
 #include "base/base_paths.h"
 #include "base/bind.h"
-#include "base/json/json_reader.h"
 #include "base/logging.h"
 #include "base/macros.h"
 #include "base/memory/ptr_util.h"
 #include "base/metrics/histogram_macros.h"
 #include "base/strings/utf_string_conversions.h"
 #include "base/threading/scoped_blocking_call.h"
-#include "base/values.h"
+#include "brave/components/brave_shields/browser/https_everywhere_rules.h"
+#include "brave/components/brave_shields/browser/https_everywhere_ruleset.h"
 #include "third_party/leveldatabase/src/include/leveldb/db.h"
-#include "third_party/re2/src/re2/re2.h"
 #include "third_party/zlib/google/zip.h"
 
 #define DAT_FILE "httpse.leveldb.zip"
 #define DAT_FILE_VERSION "6.0"
+#define RULESET_FILE "httpse.ruleset"
 #define HTTPSE_URLS_REDIRECTS_COUNT_QUEUE   1
 #define HTTPSE_URL_MAX_REDIRECTS_COUNT      5
 
@@ -107,6 +107,8 @@ HTTPSEverywhereService::HTTPSEverywhereService(
 
 HTTPSEverywhereService::~HTTPSEverywhereService() {
   GetTaskRunner()->DeleteSoon(FROM_HERE, level_db_);
+  if (ruleset_)
+    GetTaskRunner()->DeleteSoon(FROM_HERE, std::move(ruleset_));
 }
 
 bool HTTPSEverywhereService::Init() {
@@ -122,14 +124,22 @@ void HTTPSEverywhereService::InitDB(const base::FilePath& install_dir) {
       install_dir.AppendASCII(DAT_FILE_VERSION).AppendASCII(DAT_FILE);
   base::FilePath unzipped_level_db_path = zip_db_file_path.RemoveExtension();
   base::FilePath destination = zip_db_file_path.DirName();
+  base::FilePath ruleset_path = destination.AppendASCII(RULESET_FILE);
+
+  CloseDatabase();
+
+  // The ruleset is built the first time a component version is loaded, so
+  // later loads skip unzipping and reading the database.
+  ruleset_ = HTTPSERuleset::Open(ruleset_path);
+  if (ruleset_)
+    return;
+
   if (!zip::Unzip(zip_db_file_path, destination)) {
     LOG(ERROR) << "Failed to unzip database file "
                << zip_db_file_path.value().c_str();
     return;
   }
 
-  CloseDatabase();
-
   leveldb::Options options;
   leveldb::Status status =
       leveldb::DB::Open(options,
@@ -142,6 +152,17 @@ void HTTPSEverywhereService::InitDB(const base::FilePath& install_dir) {
     CloseDatabase();
     return;
   }
+
+  if (HTTPSERuleset::Build(level_db_, ruleset_path))
+    ruleset_ = HTTPSERuleset::Open(ruleset_path);
+  if (!ruleset_) {
+    // Rules are still read from the database, just more slowly.
+    LOG(ERROR) << "Failed to build HTTPSE ruleset "
+               << ruleset_path.value().c_str();
+    return;
+  }
+  delete level_db_;
+  level_db_ = nullptr;
 }
 
 void HTTPSEverywhereService::OnComponentReady(
@@ -162,41 +183,25 @@ bool HTTPSEverywhereService::GetHTTPSURL(
   if (!url->is_valid())
     return false;
 
-  if (!IsInitialized() || !level_db_ || url->scheme() == url::kHttpsScheme) {
+  if (!IsInitialized() || (!ruleset_ && !level_db_) ||
+      url->scheme() == url::kHttpsScheme) {
     return false;
   }
   if (!ShouldHTTPSERedirect(request_identifier)) {
     return false;
   }
 
-  if (recently_used_cache_.get(url->spec(), new_url)) {
-    AddHTTPSEUrlToRedirectList(request_identifier);
-    return true;
-  }
-
-  GURL candidate_url(*url);
-  if (g_ignore_port_for_test_ && candidate_url.has_port()) {
-    GURL::Replacements replacements;
-    replacements.ClearPort();
-    candidate_url = candidate_url.ReplaceComponents(replacements);
-  }
-
   SCOPED_UMA_HISTOGRAM_TIMER("Brave.HTTPSE.GetHTTPSURL");
-  const std::vector<std::string> domains =
-      ExpandDomainForLookup(candidate_url.host());
-  for (auto domain : domains) {
-    std::string value = leveldbGet(level_db_, domain);
-    if (!value.empty()) {
-      *new_url = ApplyHTTPSRule(candidate_url.spec(), value);
-      if (0 != new_url->length()) {
-        recently_used_cache_.add(candidate_url.spec(), *new_url);
-        AddHTTPSEUrlToRedirectList(request_identifier);
-        return true;
-      }
-    }
+  scoped_refptr<const HTTPSERules> rules = rule_cache_.Get(url->host());
+  if (!rules) {
+    rules = LoadRules(url->host());
+    rule_cache_.Put(url->host(), rules);
   }
-  recently_used_cache_.remove(candidate_url.spec());
-  return false;
+
+  if (!ApplyRules(*url, *rules, new_url))
+    return false;
+  AddHTTPSEUrlToRedirectList(request_identifier);
+  return true;
 }
 
 bool HTTPSEverywhereService::GetHTTPSURLFromCacheOnly(
@@ -213,11 +218,43 @@ bool HTTPSEverywhereService::GetHTTPSURLFromCacheOnly(
     return false;
   }
 
-  if (recently_used_cache_.get(url->spec(), cached_url)) {
-    AddHTTPSEUrlToRedirectList(request_identifier);
-    return true;
+  scoped_refptr<const HTTPSERules> rules = rule_cache_.Get(url->host());
+  if (!rules || !ApplyRules(*url, *rules, cached_url))
+    return false;
+  AddHTTPSEUrlToRedirectList(request_identifier);
+  return true;
+}
+
+scoped_refptr<const HTTPSERules> HTTPSEverywhereService::LoadRules(
+    const std::string& host) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  if (ruleset_)
+    return ruleset_->GetRules(host);
+
+  std::vector<std::string> rule_sets;
+  for (const std::string& domain : ExpandDomainForLookup(host)) {
+    std::string value = leveldbGet(level_db_, domain);
+    if (!value.empty())
+      rule_sets.push_back(std::move(value));
+  }
+  return HTTPSERules::Compile(rule_sets);
+}
+
+bool HTTPSEverywhereService::ApplyRules(const GURL& url,
+                                        const HTTPSERules& rules,
+                                        std::string* new_url) {
+  if (rules.empty())
+    return false;
+
+  GURL candidate_url(url);
+  if (g_ignore_port_for_test_ && candidate_url.has_port()) {
+    GURL::Replacements replacements;
+    replacements.ClearPort();
+    candidate_url = candidate_url.ReplaceComponents(replacements);
   }
-  return false;
+
+  *new_url = rules.Apply(candidate_url.spec());
+  return !new_url->empty();
 }
 
 bool HTTPSEverywhereService::ShouldHTTPSERedirect(
@@ -262,124 +299,15 @@ void HTTPSEverywhereService::AddHTTPSEUrlToRedirectList(
   }
 }
 
-std::string HTTPSEverywhereService::ApplyHTTPSRule(
-    const std::string& originalUrl,
-    const std::string& rule) {
-  absl::optional<base::Value> json_object = base::JSONReader::Read(rule);
-  if (absl::nullopt == json_object || !json_object->is_list()) {
-    return "";
-  }
-
-  base::Value::ConstListView topValues = json_object->GetList();
-  for (auto it = topValues.cbegin(); it != topValues.cend(); ++it) {
-    if (!it->is_dict()) {
-      continue;
-    }
-    const base::DictionaryValue* childTopDictionary = nullptr;
-    it->GetAsDictionary(&childTopDictionary);
-    if (nullptr == childTopDictionary) {
-      continue;
-    }
-
-    const base::Value* exclusion = nullptr;
-    if (childTopDictionary->Get("e", &exclusion)) {
-      const base::ListValue* eValues = nullptr;
-      exclusion->GetAsList(&eValues);
-      if (nullptr != eValues) {
-        for (size_t j = 0; j < eValues->GetSize(); ++j) {
-          const base::Value* pValue = nullptr;
-          if (!eValues->Get(j, &pValue)) {
-            continue;
-          }
-          const base::DictionaryValue* pDictionary = nullptr;
-          pValue->GetAsDictionary(&pDictionary);
-          if (nullptr == pDictionary) {
-            continue;
-          }
-          const base::Value* patternValue = nullptr;
-          if (!pDictionary->Get("p", &patternValue)) {
-            continue;
-          }
-          std::string pattern;
-          if (!patternValue->GetAsString(&pattern)) {
-            continue;
-          }
-          pattern = CorrecttoRuleToRE2Engine(pattern);
-          if (RE2::FullMatch(originalUrl, pattern)) {
-            return "";
-          }
-        }
-      }
-    }
-
-    const base::Value* rules = nullptr;
-    if (!childTopDictionary->Get("r", &rules)) {
-      return "";
-    }
-    const base::ListValue* rValues = nullptr;
-    rules->GetAsList(&rValues);
-    if (nullptr == rValues) {
-      return "";
-    }
-
-    for (size_t j = 0; j < rValues->GetSize(); ++j) {
-      const base::Value* pValue = nullptr;
-      if (!rValues->Get(j, &pValue)) {
-        continue;
-      }
-      const base::DictionaryValue* pDictionary = nullptr;
-      pValue->GetAsDictionary(&pDictionary);
-      if (nullptr == pDictionary) {
-        continue;
-      }
-      const base::Value* patternValue = nullptr;
-      if (pDictionary->Get("d", &patternValue)) {
-        std::string newUrl(originalUrl);
-        return newUrl.insert(4, "s");
-      }
-
-      const base::Value* from_value = nullptr;
-      const base::Value* to_value = nullptr;
-      if (!pDictionary->Get("f", &from_value) ||
-          !pDictionary->Get("t", &to_value)) {
-        continue;
-      }
-      std::string from, to;
-      if (!from_value->GetAsString(&from) ||
-          !to_value->GetAsString(&to)) {
-        continue;
-      }
-
-      to = CorrecttoRuleToRE2Engine(to);
-      std::string newUrl(originalUrl);
-      RE2 regExp(from);
-
-      if (RE2::Replace(&newUrl, regExp, to) && newUrl != originalUrl) {
-        return newUrl;
-      }
-    }
-  }
-  return "";
-}
-
-std::string HTTPSEverywhereService::CorrecttoRuleToRE2Engine(
-    const std::string& to) {
-  std::string correctedto(to);
-  size_t pos = to.find("$");
-  while (std::string::npos != pos) {
-    correctedto[pos] = '\\';
-    pos = correctedto.find("$");
-  }
-
-  return correctedto;
-}
-
 void HTTPSEverywhereService::CloseDatabase() {
   DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
   if (level_db_) {
     delete level_db_;
     level_db_ = nullptr;
   }
+  ruleset_.reset();
+  // The cached rules came from the database that was just closed.
+  rule_cache_.Clear();
 }
 
 // static
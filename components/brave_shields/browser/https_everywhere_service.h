@@ -15,7 +15,7 @@
 #include "base/sequence_checker.h"
 #include "base/synchronization/lock.h"
 #include "brave/components/brave_shields/browser/base_brave_shields_service.h"
-#include "brave/components/brave_shields/browser/https_everywhere_recently_used_cache.h"
+#include "brave/components/brave_shields/browser/https_everywhere_rule_cache.h"
 
 namespace leveldb {
 class DB;
@@ -27,6 +27,8 @@ using brave_component_updater::BraveComponent;
 
 namespace brave_shields {
 
+class HTTPSERuleset;
+
 extern const char kHTTPSEverywhereComponentName[];
 extern const char kHTTPSEverywhereComponentId[];
 extern const char kHTTPSEverywhereComponentBase64PublicKey[];
@@ -63,9 +65,6 @@ class HTTPSEverywhereService : public BaseBraveShieldsService,
 
   void AddHTTPSEUrlToRedirectList(const uint64_t& request_id);
   bool ShouldHTTPSERedirect(const uint64_t& request_id);
-  std::string ApplyHTTPSRule(const std::string& originalUrl,
-      const std::string& rule);
-  std::string CorrecttoRuleToRE2Engine(const std::string& to);
 
  private:
   friend class ::HTTPSEverywhereServiceTest;
@@ -78,12 +77,22 @@ class HTTPSEverywhereService : public BaseBraveShieldsService,
       const std::string& component_base64_public_key);
 
   void CloseDatabase();
+  // Reads and compiles the rules for |host| from the ruleset, or from the
+  // database if the ruleset could not be built.
+  scoped_refptr<const HTTPSERules> LoadRules(const std::string& host);
+  // Applies |rules| to |url|. Returns false if no rule rewrote it.
+  bool ApplyRules(const GURL& url,
+                  const HTTPSERules& rules,
+                  std::string* new_url);
 
   void InitDB(const base::FilePath& install_dir);
 
   base::Lock httpse_get_urls_redirects_count_mutex_;
   std::vector<HTTPSE_REDIRECTS_COUNT_ST> httpse_urls_redirects_count_;
-  HTTPSERecentlyUsedCache<std::string> recently_used_cache_;
+  // Compiled rules by host, shared with GetHTTPSURLFromCacheOnly() callers on
+  // other threads.
+  HTTPSERuleCache rule_cache_;
+  std::unique_ptr<HTTPSERuleset> ruleset_;
   leveldb::DB* level_db_;
 
   SEQUENCE_CHECKER(sequence_checker_);
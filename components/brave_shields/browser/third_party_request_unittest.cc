@@ -0,0 +1,81 @@
+/* Copyright (c) 2021 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <string>
+
+#include "brave/components/brave_shields/browser/ad_block_service_helper.h"
+#include "net/base/registry_controlled_domains/registry_controlled_domain.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "url/gurl.h"
+#include "url/origin.h"
+
+namespace brave_shields {
+
+namespace {
+
+// How the third-party check was made before IsThirdPartyRequest().
+bool IsThirdPartyWithOrigin(const GURL& url, const std::string& tab_host) {
+  const url::Origin tab_origin =
+      tab_host.empty()
+          ? url::Origin()
+          : url::Origin::CreateFromNormalizedTuple("https", tab_host, 443);
+  return !net::registry_controlled_domains::SameDomainOrHost(
+      url, tab_origin,
+      net::registry_controlled_domains::INCLUDE_PRIVATE_REGISTRIES);
+}
+
+void ExpectThirdParty(const std::string& spec,
+                      const std::string& tab_host,
+                      bool expected) {
+  const GURL url(spec);
+  EXPECT_EQ(expected, IsThirdPartyRequest(url, tab_host))
+      << spec << " on " << tab_host;
+  EXPECT_EQ(IsThirdPartyWithOrigin(url, tab_host),
+            IsThirdPartyRequest(url, tab_host))
+      << spec << " on " << tab_host;
+}
+
+}  // namespace
+
+TEST(ThirdPartyRequestTest, Subdomains) {
+  ExpectThirdParty("https://example.com/a.js", "example.com", false);
+  ExpectThirdParty("https://cdn.example.com/a.js", "www.example.com", false);
+  ExpectThirdParty("https://a.b.example.co.uk/a.js", "example.co.uk", false);
+  ExpectThirdParty("https://EXAMPLE.com/a.js", "example.com", false);
+  ExpectThirdParty("https://example.org/a.js", "example.com", true);
+  ExpectThirdParty("https://example.com.evil.com/a.js", "example.com", true);
+  ExpectThirdParty("https://example.com./a.js", "example.com", true);
+}
+
+TEST(ThirdPartyRequestTest, PublicAndPrivateRegistries) {
+  ExpectThirdParty("https://co.uk/a.js", "example.co.uk", true);
+  ExpectThirdParty("https://a.github.io/a.js", "b.github.io", true);
+  ExpectThirdParty("https://x.a.github.io/a.js", "a.github.io", false);
+  ExpectThirdParty("https://github.io/a.js", "a.github.io", true);
+}
+
+TEST(ThirdPartyRequestTest, IPAddresses) {
+  ExpectThirdParty("https://192.168.0.1/a.js", "192.168.0.1", false);
+  ExpectThirdParty("https://192.168.0.1/a.js", "192.168.0.2", true);
+  ExpectThirdParty("https://10.0.0.1/a.js", "example.com", true);
+  ExpectThirdParty("https://example.com/a.js", "10.0.0.1", true);
+  ExpectThirdParty("https://[::1]/a.js", "[::1]", false);
+  ExpectThirdParty("https://[::1]/a.js", "[::2]", true);
+}
+
+TEST(ThirdPartyRequestTest, HostsWithoutRegistry) {
+  ExpectThirdParty("http://localhost/a.js", "localhost", false);
+  ExpectThirdParty("http://a.localhost/a.js", "b.localhost", true);
+  ExpectThirdParty("http://intranet/a.js", "example.com", true);
+}
+
+TEST(ThirdPartyRequestTest, EmptyHosts) {
+  ExpectThirdParty("https://example.com/a.js", "", true);
+  ExpectThirdParty("file:///tmp/a.js", "example.com", true);
+  ExpectThirdParty("data:text/javascript,", "example.com", true);
+  ExpectThirdParty("file:///tmp/a.js", "", true);
+}
+
+}  // namespace brave_shields
@@ -38,6 +38,10 @@ const char kObsoleteFingerprinting[] = "fingerprinting";
 const base::FilePath::CharType kCustomSubscriptionListText[] =
     FPL("list_text.txt");
 
+// Filename for the plain text filter list shipped alongside a precompiled
+// adblock component DAT file, if any
+const base::FilePath::CharType kAdBlockComponentListText[] = FPL("list.txt");
+
 }  // namespace brave_shields
 
 #endif  // BRAVE_COMPONENTS_BRAVE_SHIELDS_COMMON_BRAVE_SHIELD_CONSTANTS_H_
@@ -25,6 +25,10 @@ const base::Feature kBraveAdblockCnameUncloaking{
 // iframes that initiate a blocked network request.
 const base::Feature kBraveAdblockCollapseBlockedElements{
     "BraveAdblockCollapseBlockedElements", base::FEATURE_ENABLED_BY_DEFAULT};
+// When enabled, network requests are matched against the adblock engines on a
+// pool of threads instead of on the single adblock sequence.
+const base::Feature kBraveAdblockConcurrentMatching{
+    "BraveAdblockConcurrentMatching", base::FEATURE_ENABLED_BY_DEFAULT};
 const base::Feature kBraveAdblockCosmeticFiltering{
     "BraveAdblockCosmeticFiltering",
     base::FEATURE_ENABLED_BY_DEFAULT};
@@ -32,6 +36,17 @@ const base::Feature kBraveAdblockCosmeticFilteringNative{
     "BraveAdblockCosmeticFilteringNative", base::FEATURE_DISABLED_BY_DEFAULT};
 const base::Feature kBraveAdblockCspRules{
     "BraveAdblockCspRules", base::FEATURE_ENABLED_BY_DEFAULT};
+// When enabled, network blocking decisions are memoized per request URL, tab
+// host and resource type until any engine, tag or resource set changes. Off by
+// default, since every lookup takes a shard lock that concurrent matching
+// threads can contend on.
+const base::Feature kBraveAdblockDecisionCache{
+    "BraveAdblockDecisionCache", base::FEATURE_DISABLED_BY_DEFAULT};
+// When enabled, the network rules of every filter list that is available as
+// text are compiled into one combined engine, so each request is matched with
+// a single lookup instead of one lookup per list.
+const base::Feature kBraveAdblockMergedEngine{
+    "BraveAdblockMergedEngine", base::FEATURE_DISABLED_BY_DEFAULT};
 // When enabled, Brave will block domains listed in the user's selected adblock
 // filters and present a security interstitial with choice to proceed and
 // optionally whitelist the domain.
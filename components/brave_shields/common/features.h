@@ -15,9 +15,12 @@ namespace features {
 extern const base::Feature kBraveAdblockDefault1pBlocking;
 extern const base::Feature kBraveAdblockCnameUncloaking;
 extern const base::Feature kBraveAdblockCollapseBlockedElements;
+extern const base::Feature kBraveAdblockConcurrentMatching;
 extern const base::Feature kBraveAdblockCosmeticFiltering;
 extern const base::Feature kBraveAdblockCosmeticFilteringNative;
 extern const base::Feature kBraveAdblockCspRules;
+extern const base::Feature kBraveAdblockDecisionCache;
+extern const base::Feature kBraveAdblockMergedEngine;
 extern const base::Feature kBraveDomainBlock;
 extern const base::Feature kBraveExtensionNetworkBlocking;
 extern const base::Feature kBraveDarkModeBlock;
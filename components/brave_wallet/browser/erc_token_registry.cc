@@ -5,14 +5,18 @@
 
 #include "brave/components/brave_wallet/browser/erc_token_registry.h"
 
-#include <algorithm>
 #include <utility>
 
+#include "base/strings/string_util.h"
 #include "brave/components/brave_wallet/browser/brave_wallet_constants.h"
+#include "mojo/public/cpp/bindings/clone_traits.h"
 
 namespace brave_wallet {
 
-ERCTokenRegistry::ERCTokenRegistry() = default;
+ERCTokenRegistry::ERCTokenRegistry() {
+  for (const auto& token : *kBuyTokens)
+    buy_tokens_.push_back(token.Clone());
+}
 
 ERCTokenRegistry::~ERCTokenRegistry() {}
 
@@ -34,57 +38,45 @@ void ERCTokenRegistry::Bind(
 void ERCTokenRegistry::UpdateTokenList(
     std::vector<mojom::ERCTokenPtr> erc_tokens) {
   erc_tokens_ = std::move(erc_tokens);
+
+  contract_index_.clear();
+  symbol_index_.clear();
+  contract_index_.reserve(erc_tokens_.size());
+  symbol_index_.reserve(erc_tokens_.size());
+  for (size_t i = 0; i < erc_tokens_.size(); ++i) {
+    contract_index_.emplace(
+        base::ToLowerASCII(erc_tokens_[i]->contract_address), i);
+    symbol_index_.emplace(base::ToLowerASCII(erc_tokens_[i]->symbol), i);
+  }
+}
+
+const mojom::ERCToken* ERCTokenRegistry::FindToken(
+    const std::unordered_map<std::string, size_t>& index,
+    const std::string& key) const {
+  auto it = index.find(base::ToLowerASCII(key));
+  if (it == index.end())
+    return nullptr;
+  return erc_tokens_[it->second].get();
 }
 
 void ERCTokenRegistry::GetTokenByContract(const std::string& contract,
                                           GetTokenByContractCallback callback) {
-  auto token_it =
-      std::find_if(erc_tokens_.begin(), erc_tokens_.end(),
-                   [&](const mojom::ERCTokenPtr& current_token) {
-                     return current_token->contract_address == contract;
-                   });
-  if (token_it == erc_tokens_.end()) {
-    std::move(callback).Run(nullptr);
-    return;
-  }
-  std::move(callback).Run(token_it->Clone());
+  const mojom::ERCToken* token = FindToken(contract_index_, contract);
+  std::move(callback).Run(token ? token->Clone() : nullptr);
 }
 
 void ERCTokenRegistry::GetTokenBySymbol(const std::string& symbol,
                                         GetTokenBySymbolCallback callback) {
-  auto token_it = std::find_if(erc_tokens_.begin(), erc_tokens_.end(),
-                               [&](const mojom::ERCTokenPtr& current_token) {
-                                 return current_token->symbol == symbol;
-                               });
-
-  if (token_it == erc_tokens_.end()) {
-    std::move(callback).Run(nullptr);
-    return;
-  }
-
-  std::move(callback).Run(token_it->Clone());
+  const mojom::ERCToken* token = FindToken(symbol_index_, symbol);
+  std::move(callback).Run(token ? token->Clone() : nullptr);
 }
 
 void ERCTokenRegistry::GetAllTokens(GetAllTokensCallback callback) {
-  std::vector<brave_wallet::mojom::ERCTokenPtr> erc_tokens_copy(
-      erc_tokens_.size());
-  std::transform(erc_tokens_.begin(), erc_tokens_.end(),
-                 erc_tokens_copy.begin(),
-                 [](const brave_wallet::mojom::ERCTokenPtr& current_token)
-                     -> brave_wallet::mojom::ERCTokenPtr {
-                   return current_token.Clone();
-                 });
-  std::move(callback).Run(std::move(erc_tokens_copy));
+  std::move(callback).Run(mojo::Clone(erc_tokens_));
 }
 
 void ERCTokenRegistry::GetBuyTokens(GetBuyTokensCallback callback) {
-  std::vector<brave_wallet::mojom::ERCTokenPtr> erc_buy_tokens;
-  for (auto token : *kBuyTokens) {
-    auto erc_token = brave_wallet::mojom::ERCToken::New();
-    *erc_token = token;
-    erc_buy_tokens.push_back(std::move(erc_token));
-  }
-  std::move(callback).Run(std::move(erc_buy_tokens));
+  std::move(callback).Run(mojo::Clone(buy_tokens_));
 }
 
 }  // namespace brave_wallet
@@ -7,6 +7,7 @@
 #define BRAVE_COMPONENTS_BRAVE_WALLET_BROWSER_ERC_TOKEN_REGISTRY_H_
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "base/macros.h"
@@ -29,6 +30,9 @@ class ERCTokenRegistry : public mojom::ERCTokenRegistry {
   mojo::PendingRemote<mojom::ERCTokenRegistry> MakeRemote();
   void Bind(mojo::PendingReceiver<mojom::ERCTokenRegistry> receiver);
 
+  // Replaces the registry tokens and rebuilds the lookup indexes. Contract
+  // addresses and symbols are matched case-insensitively, and the first token
+  // in |erc_tokens| wins when several share one.
   void UpdateTokenList(std::vector<mojom::ERCTokenPtr> erc_tokens);
 
   // ERCTokenRegistry interface methods
@@ -46,6 +50,15 @@ class ERCTokenRegistry : public mojom::ERCTokenRegistry {
   ERCTokenRegistry();
 
  private:
+  const mojom::ERCToken* FindToken(
+      const std::unordered_map<std::string, size_t>& index,
+      const std::string& key) const;
+
+  // Lowercased contract address and symbol to index in |erc_tokens_|.
+  std::unordered_map<std::string, size_t> contract_index_;
+  std::unordered_map<std::string, size_t> symbol_index_;
+  // Built once from kBuyTokens.
+  std::vector<mojom::ERCTokenPtr> buy_tokens_;
   mojo::ReceiverSet<mojom::ERCTokenRegistry> receivers_;
 };
 
@@ -8,6 +8,7 @@
 #include <vector>
 
 #include "base/test/bind.h"
+#include "brave/components/brave_wallet/browser/brave_wallet_constants.h"
 #include "brave/components/brave_wallet/browser/erc_token_list_parser.h"
 #include "brave/components/brave_wallet/browser/erc_token_registry.h"
 #include "testing/gtest/include/gtest/gtest.h"
@@ -117,4 +118,33 @@ TEST(ERCTokenRegistryUnitTest, GetTokenBySymbol) {
       base::BindOnce([](mojom::ERCTokenPtr token) { ASSERT_FALSE(token); }));
 }
 
+TEST(ERCTokenRegistryUnitTest, LookupsIgnoreCase) {
+  auto* registry = ERCTokenRegistry::GetInstance();
+  std::vector<mojom::ERCTokenPtr> input_erc_tokens;
+  ASSERT_TRUE(ParseTokenList(token_list_json, &input_erc_tokens));
+  registry->UpdateTokenList(std::move(input_erc_tokens));
+  registry->GetTokenByContract("0x0d8775f648430679a709e98d2b0cb6250d2887ef",
+                               base::BindOnce([](mojom::ERCTokenPtr token) {
+                                 ASSERT_TRUE(token);
+                                 EXPECT_EQ(token->symbol, "BAT");
+                               }));
+
+  registry->GetTokenBySymbol(
+      "uni", base::BindOnce([](mojom::ERCTokenPtr token) {
+        ASSERT_TRUE(token);
+        EXPECT_EQ(token->contract_address,
+                  "0x1f9840a85d5aF5bf1D1762F925BDADdC4201F984");
+      }));
+}
+
+TEST(ERCTokenRegistryUnitTest, GetBuyTokens) {
+  auto* registry = ERCTokenRegistry::GetInstance();
+  registry->GetBuyTokens(
+      base::BindOnce([](std::vector<mojom::ERCTokenPtr> token_list) {
+        ASSERT_EQ(token_list.size(), kBuyTokens->size());
+        for (size_t i = 0; i < token_list.size(); ++i)
+          EXPECT_EQ(*token_list[i], (*kBuyTokens)[i]);
+      }));
+}
+
 }  // namespace brave_wallet
@@ -7,12 +7,9 @@
 
 #include <utility>
 
-#include "base/json/json_reader.h"
-#include "base/values.h"
 #include "brave/components/brave_shields/browser/ad_block_service.h"
 #include "brave/components/brave_shields/browser/brave_shields_util.h"
 #include "components/content_settings/core/browser/host_content_settings_map.h"
-#include "third_party/abseil-cpp/absl/types/optional.h"
 
 namespace cosmetic_filters {
 
@@ -26,43 +23,10 @@ CosmeticFiltersResources::CosmeticFiltersResources(
 CosmeticFiltersResources::~CosmeticFiltersResources() {}
 
 void CosmeticFiltersResources::HiddenClassIdSelectors(
-    const std::string& input,
+    const std::vector<std::string>& classes,
+    const std::vector<std::string>& ids,
     const std::vector<std::string>& exceptions,
     HiddenClassIdSelectorsCallback callback) {
-  absl::optional<base::Value> input_value = base::JSONReader::Read(input);
-  if (!input_value || !input_value->is_dict()) {
-    // Nothing to work with
-    std::move(callback).Run(base::Value());
-
-    return;
-  }
-  base::DictionaryValue* input_dict;
-  if (!input_value->GetAsDictionary(&input_dict)) {
-    std::move(callback).Run(base::Value());
-
-    return;
-  }
-  std::vector<std::string> classes;
-  base::ListValue* classes_list;
-  if (input_dict->GetList("classes", &classes_list)) {
-    for (size_t i = 0; i < classes_list->GetSize(); i++) {
-      if (!classes_list->GetList()[i].is_string()) {
-        continue;
-      }
-      classes.push_back(classes_list->GetList()[i].GetString());
-    }
-  }
-  std::vector<std::string> ids;
-  base::ListValue* ids_list;
-  if (input_dict->GetList("ids", &ids_list)) {
-    for (size_t i = 0; i < ids_list->GetSize(); i++) {
-      if (!ids_list->GetList()[i].is_string()) {
-        continue;
-      }
-      ids.push_back(ids_list->GetList()[i].GetString());
-    }
-  }
-
   ad_block_service_->GetTaskRunner()->PostTaskAndReplyWithResult(
       FROM_HERE,
       base::BindOnce(&brave_shields::AdBlockService::HiddenClassIdSelectors,
@@ -74,16 +38,14 @@ void CosmeticFiltersResources::HiddenClassIdSelectors(
 
 void CosmeticFiltersResources::HiddenClassIdSelectorsOnUI(
     HiddenClassIdSelectorsCallback callback,
-    absl::optional<base::Value> resources) {
-  std::move(callback).Run(resources ? std::move(resources.value())
-                                    : base::Value());
+    mojom::CosmeticResourcesPtr resources) {
+  std::move(callback).Run(std::move(resources));
 }
 
 void CosmeticFiltersResources::UrlCosmeticResourcesOnUI(
     UrlCosmeticResourcesCallback callback,
-    absl::optional<base::Value> resources) {
-  std::move(callback).Run(resources ? std::move(resources.value())
-                                    : base::Value());
+    mojom::CosmeticResourcesPtr resources) {
+  std::move(callback).Run(std::move(resources));
 }
 
 void CosmeticFiltersResources::ShouldDoCosmeticFiltering(
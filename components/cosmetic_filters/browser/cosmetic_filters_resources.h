@@ -11,9 +11,7 @@
 #include <vector>
 
 #include "base/memory/weak_ptr.h"
-#include "base/values.h"
 #include "brave/components/cosmetic_filters/common/cosmetic_filters.mojom.h"
-#include "third_party/abseil-cpp/absl/types/optional.h"
 
 class HostContentSettingsMap;
 
@@ -43,7 +41,8 @@ class CosmeticFiltersResources final
 
   // Sends back to renderer a response about rules that has to be applied
   // for the specified selectors.
-  void HiddenClassIdSelectors(const std::string& input,
+  void HiddenClassIdSelectors(const std::vector<std::string>& classes,
+                              const std::vector<std::string>& ids,
                               const std::vector<std::string>& exceptions,
                               HiddenClassIdSelectorsCallback callback) override;
 
@@ -54,10 +53,10 @@ class CosmeticFiltersResources final
 
  private:
   void HiddenClassIdSelectorsOnUI(HiddenClassIdSelectorsCallback callback,
-                                  absl::optional<base::Value> resources);
+                                  mojom::CosmeticResourcesPtr resources);
 
   void UrlCosmeticResourcesOnUI(UrlCosmeticResourcesCallback callback,
-                                absl::optional<base::Value> resources);
+                                mojom::CosmeticResourcesPtr resources);
 
   HostContentSettingsMap* settings_map_;             // Not owned
   brave_shields::AdBlockService* ad_block_service_;  // Not owned
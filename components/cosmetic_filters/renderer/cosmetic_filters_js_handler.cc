@@ -8,7 +8,8 @@
 #include <utility>
 
 #include "base/bind.h"
-#include "base/json/json_writer.h"
+#include "base/containers/flat_map.h"
+#include "base/json/string_escape.h"
 #include "base/no_destructor.h"
 #include "base/strings/stringprintf.h"
 #include "base/strings/utf_string_conversions.h"
@@ -164,6 +165,33 @@ std::string LoadDataResource(const int id) {
   return std::string(resource_bundle.GetRawDataResource(id));
 }
 
+// Serializes |strings| as a JSON array literal that can be embedded into the
+// injected scripts.
+std::string ToJSONArray(const std::vector<std::string>& strings) {
+  std::string json = "[";
+  for (size_t i = 0; i < strings.size(); i++) {
+    if (i != 0)
+      json += ',';
+    base::EscapeJSONString(strings[i], /*put_in_quotes=*/true, &json);
+  }
+  json += ']';
+  return json;
+}
+
+std::string ToJSONObject(
+    const base::flat_map<std::string, std::vector<std::string>>& map) {
+  std::string json = "{";
+  for (auto it = map.begin(); it != map.end(); ++it) {
+    if (it != map.begin())
+      json += ',';
+    base::EscapeJSONString(it->first, /*put_in_quotes=*/true, &json);
+    json += ':';
+    json += ToJSONArray(it->second);
+  }
+  json += '}';
+  return json;
+}
+
 bool IsVettedSearchEngine(const GURL& url) {
   std::string domain_and_registry =
       net::registry_controlled_domains::GetDomainAndRegistry(
@@ -202,14 +230,26 @@ CosmeticFiltersJSHandler::CosmeticFiltersJSHandler(
 CosmeticFiltersJSHandler::~CosmeticFiltersJSHandler() = default;
 
 void CosmeticFiltersJSHandler::HiddenClassIdSelectors(
-    const std::string& input) {
-  if (!EnsureConnected())
+    const std::vector<std::string>& classes,
+    const std::vector<std::string>& ids) {
+  pending_classes_.insert(pending_classes_.end(), classes.begin(),
+                          classes.end());
+  pending_ids_.insert(pending_ids_.end(), ids.begin(), ids.end());
+  if (!hidden_class_id_query_in_flight_)
+    FlushHiddenClassIdSelectors();
+}
+
+void CosmeticFiltersJSHandler::FlushHiddenClassIdSelectors() {
+  if ((pending_classes_.empty() && pending_ids_.empty()) || !EnsureConnected())
     return;
 
+  hidden_class_id_query_in_flight_ = true;
   cosmetic_filters_resources_->HiddenClassIdSelectors(
-      input, exceptions_,
+      pending_classes_, pending_ids_, exceptions_,
       base::BindOnce(&CosmeticFiltersJSHandler::OnHiddenClassIdSelectors,
                      base::Unretained(this)));
+  pending_classes_.clear();
+  pending_ids_.clear();
 }
 
 void CosmeticFiltersJSHandler::AddJavaScriptObjectToFrame(
@@ -281,12 +321,16 @@ bool CosmeticFiltersJSHandler::EnsureConnected() {
 
 void CosmeticFiltersJSHandler::OnRemoteDisconnect() {
   cosmetic_filters_resources_.reset();
+  // The reply of an in-flight query is dropped with the pipe.
+  hidden_class_id_query_in_flight_ = false;
   EnsureConnected();
 }
 
 void CosmeticFiltersJSHandler::ProcessURL(const GURL& url,
                                           base::OnceClosure callback) {
-  resources_dict_.reset();
+  resources_.reset();
+  pending_classes_.clear();
+  pending_ids_.clear();
   url_ = url;
   // Trivially, don't make exceptions for malformed URLs.
   if (!EnsureConnected() || url_.is_empty() || !url_.is_valid())
@@ -314,24 +358,21 @@ void CosmeticFiltersJSHandler::OnShouldDoCosmeticFiltering(
 
 void CosmeticFiltersJSHandler::OnUrlCosmeticResources(
     base::OnceClosure callback,
-    base::Value result) {
-  resources_dict_ = base::DictionaryValue::From(
-      base::Value::ToUniquePtrValue(std::move(result)));
+    mojom::CosmeticResourcesPtr resources) {
+  resources_ = std::move(resources);
   std::move(callback).Run();
 }
 
 void CosmeticFiltersJSHandler::ApplyRules() {
   blink::WebLocalFrame* web_frame = render_frame_->GetWebFrame();
-  if (!resources_dict_ || web_frame->IsProvisional())
+  if (!resources_ || web_frame->IsProvisional())
     return;
 
   std::string scriptlet_script;
-  base::Value* injected_script = resources_dict_->FindPath("injected_script");
-  if (injected_script &&
-      base::JSONWriter::Write(*injected_script, &scriptlet_script)) {
-    scriptlet_script =
-        base::StringPrintf(kScriptletInitScript, scriptlet_script.c_str());
-  }
+  base::EscapeJSONString(resources_->injected_script, /*put_in_quotes=*/true,
+                         &scriptlet_script);
+  scriptlet_script =
+      base::StringPrintf(kScriptletInitScript, scriptlet_script.c_str());
   if (!scriptlet_script.empty()) {
     web_frame->ExecuteScriptInIsolatedWorld(
         isolated_world_id_, blink::WebString::FromUTF8(scriptlet_script),
@@ -342,11 +383,9 @@ void CosmeticFiltersJSHandler::ApplyRules() {
     return;
 
   // Working on css rules, we do that on a main frame only
-  bool generichide = false;
-  resources_dict_->GetBoolean("generichide", &generichide);
   std::string cosmetic_filtering_init_script = base::StringPrintf(
       kCosmeticFilteringInitScript, enabled_1st_party_cf_ ? "true" : "false",
-      generichide ? "true" : "false");
+      resources_->generichide ? "true" : "false");
   std::string pre_init_script = base::StringPrintf(
       kPreInitScript, cosmetic_filtering_init_script.c_str());
 
@@ -357,119 +396,67 @@ void CosmeticFiltersJSHandler::ApplyRules() {
       isolated_world_id_, blink::WebString::FromUTF8(*g_observing_script),
       blink::BackForwardCacheAware::kAllow);
 
-  CSSRulesRoutine(resources_dict_.get());
+  CSSRulesRoutine(*resources_);
 }
 
 void CosmeticFiltersJSHandler::CSSRulesRoutine(
-    base::DictionaryValue* resources_dict) {
+    const mojom::CosmeticResources& resources) {
   // Otherwise, if its a vetted engine AND we're not in aggressive
   // mode, also don't do cosmetic filtering.
   if (!enabled_1st_party_cf_ && IsVettedSearchEngine(url_))
     return;
 
-  blink::WebLocalFrame* web_frame = render_frame_->GetWebFrame();
-  base::ListValue* cf_exceptions_list;
-  if (resources_dict->GetList("exceptions", &cf_exceptions_list)) {
-    for (size_t i = 0; i < cf_exceptions_list->GetSize(); i++) {
-      exceptions_.push_back(cf_exceptions_list->GetList()[i].GetString());
-    }
-  }
-  base::ListValue* hide_selectors_list;
-  if (!resources_dict->GetList("hide_selectors", &hide_selectors_list)) {
-    hide_selectors_list = nullptr;
-  }
-  base::ListValue* force_hide_selectors_list;
-  if (!resources_dict->GetList("force_hide_selectors",
-                               &force_hide_selectors_list)) {
-    force_hide_selectors_list = nullptr;
-  }
+  exceptions_.insert(exceptions_.end(), resources.exceptions.begin(),
+                     resources.exceptions.end());
 
-  if (hide_selectors_list && hide_selectors_list->GetSize() != 0) {
-    std::string json_selectors;
-    if (!base::JSONWriter::Write(*hide_selectors_list, &json_selectors) ||
-        json_selectors.empty()) {
-      json_selectors = "[]";
-    }
-    // Building a script for stylesheet modifications
-    std::string new_selectors_script =
-        base::StringPrintf(kHideSelectorsInjectScript, json_selectors.c_str());
-    web_frame->ExecuteScriptInIsolatedWorld(
-        isolated_world_id_, blink::WebString::FromUTF8(new_selectors_script),
-        blink::BackForwardCacheAware::kAllow);
-  }
+  InjectHideSelectors(resources);
 
-  if (force_hide_selectors_list && force_hide_selectors_list->GetSize() != 0) {
-    std::string json_selectors;
-    if (!base::JSONWriter::Write(*force_hide_selectors_list, &json_selectors) ||
-        json_selectors.empty()) {
-      json_selectors = "[]";
-    }
-    // Building a script for stylesheet modifications
-    std::string new_selectors_script = base::StringPrintf(
-        kForceHideSelectorsInjectScript, json_selectors.c_str());
-    web_frame->ExecuteScriptInIsolatedWorld(
-        isolated_world_id_, blink::WebString::FromUTF8(new_selectors_script),
-        blink::BackForwardCacheAware::kAllow);
-  }
-
-  base::DictionaryValue* style_selectors_dictionary = nullptr;
-  if (resources_dict->GetDictionary("style_selectors",
-                                    &style_selectors_dictionary)) {
-    std::string json_selectors;
-    if (!base::JSONWriter::Write(*style_selectors_dictionary,
-                                 &json_selectors) ||
-        json_selectors.empty()) {
-      json_selectors = "[]";
-    }
+  if (!resources.style_selectors.empty()) {
     std::string new_selectors_script =
-        base::StringPrintf(kStyleSelectorsInjectScript, json_selectors.c_str());
-    if (!json_selectors.empty()) {
-      web_frame->ExecuteScriptInIsolatedWorld(
-          isolated_world_id_, blink::WebString::FromUTF8(new_selectors_script),
-          blink::BackForwardCacheAware::kAllow);
-    }
+        base::StringPrintf(kStyleSelectorsInjectScript,
+                           ToJSONObject(resources.style_selectors).c_str());
+    ExecuteScript(new_selectors_script);
   }
 
-  if (!enabled_1st_party_cf_) {
-    web_frame->ExecuteScriptInIsolatedWorld(
-        isolated_world_id_, blink::WebString::FromUTF8(*g_observing_script),
-        blink::BackForwardCacheAware::kAllow);
-  }
+  if (!enabled_1st_party_cf_)
+    ExecuteScript(*g_observing_script);
 }
 
-void CosmeticFiltersJSHandler::OnHiddenClassIdSelectors(base::Value result) {
+void CosmeticFiltersJSHandler::OnHiddenClassIdSelectors(
+    mojom::CosmeticResourcesPtr resources) {
+  hidden_class_id_query_in_flight_ = false;
+  FlushHiddenClassIdSelectors();
+
   // If its a vetted engine AND we're not in aggressive
   // mode, don't do cosmetic filtering.
   if (!enabled_1st_party_cf_ && IsVettedSearchEngine(url_))
     return;
 
-  // We expect a List value from adblock service. That is
-  // an extra check to be sure that adblock file exist and gives us
-  // rules that we expect
-  base::ListValue* selectors_list;
-  if (!result.GetAsList(&selectors_list))
-    return;
+  InjectHideSelectors(*resources);
 
-  blink::WebLocalFrame* web_frame = render_frame_->GetWebFrame();
-  std::string json_selectors;
-  if (!base::JSONWriter::Write(*selectors_list, &json_selectors) ||
-      json_selectors.empty()) {
-    json_selectors = "[]";
+  if (!enabled_1st_party_cf_)
+    ExecuteScript(*g_observing_script);
+}
+
+void CosmeticFiltersJSHandler::InjectHideSelectors(
+    const mojom::CosmeticResources& resources) {
+  // Building scripts for stylesheet modifications
+  if (!resources.hide_selectors.empty()) {
+    ExecuteScript(
+        base::StringPrintf(kHideSelectorsInjectScript,
+                           ToJSONArray(resources.hide_selectors).c_str()));
   }
-  // Building a script for stylesheet modifications
-  std::string new_selectors_script =
-      base::StringPrintf(kHideSelectorsInjectScript, json_selectors.c_str());
-  if (selectors_list->GetSize() != 0) {
-    web_frame->ExecuteScriptInIsolatedWorld(
-        isolated_world_id_, blink::WebString::FromUTF8(new_selectors_script),
-        blink::BackForwardCacheAware::kAllow);
+  if (!resources.force_hide_selectors.empty()) {
+    ExecuteScript(base::StringPrintf(
+        kForceHideSelectorsInjectScript,
+        ToJSONArray(resources.force_hide_selectors).c_str()));
   }
+}
 
-  if (!enabled_1st_party_cf_) {
-    web_frame->ExecuteScriptInIsolatedWorld(
-        isolated_world_id_, blink::WebString::FromUTF8(*g_observing_script),
-        blink::BackForwardCacheAware::kAllow);
-  }
+void CosmeticFiltersJSHandler::ExecuteScript(const std::string& script) {
+  render_frame_->GetWebFrame()->ExecuteScriptInIsolatedWorld(
+      isolated_world_id_, blink::WebString::FromUTF8(script),
+      blink::BackForwardCacheAware::kAllow);
 }
 
 }  // namespace cosmetic_filters
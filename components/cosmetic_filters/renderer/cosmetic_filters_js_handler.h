@@ -52,14 +52,21 @@ class CosmeticFiltersJSHandler {
   void CreateWorkerObject(v8::Isolate* isolate, v8::Local<v8::Context> context);
 
   // A function to be called from JS
-  void HiddenClassIdSelectors(const std::string& input);
+  void HiddenClassIdSelectors(const std::vector<std::string>& classes,
+                              const std::vector<std::string>& ids);
+  // Sends the classes and ids gathered while the previous query was in flight
+  // as a single batch.
+  void FlushHiddenClassIdSelectors();
 
   void OnShouldDoCosmeticFiltering(base::OnceClosure callback,
                                    bool enabled,
                                    bool first_party_enabled);
-  void OnUrlCosmeticResources(base::OnceClosure callback, base::Value result);
-  void CSSRulesRoutine(base::DictionaryValue* resources_dict);
-  void OnHiddenClassIdSelectors(base::Value result);
+  void OnUrlCosmeticResources(base::OnceClosure callback,
+                              mojom::CosmeticResourcesPtr resources);
+  void CSSRulesRoutine(const mojom::CosmeticResources& resources);
+  void OnHiddenClassIdSelectors(mojom::CosmeticResourcesPtr resources);
+  void InjectHideSelectors(const mojom::CosmeticResources& resources);
+  void ExecuteScript(const std::string& script);
 
   content::RenderFrame* render_frame_;
   mojo::Remote<cosmetic_filters::mojom::CosmeticFiltersResources>
@@ -68,7 +75,12 @@ class CosmeticFiltersJSHandler {
   bool enabled_1st_party_cf_;
   std::vector<std::string> exceptions_;
   GURL url_;
-  std::unique_ptr<base::DictionaryValue> resources_dict_;
+  mojom::CosmeticResourcesPtr resources_;
+  // At most one HiddenClassIdSelectors query is in flight at a time, the
+  // classes and ids reported meanwhile are batched into the next one.
+  bool hidden_class_id_query_in_flight_ = false;
+  std::vector<std::string> pending_classes_;
+  std::vector<std::string> pending_ids_;
   base::WeakPtrFactory<CosmeticFiltersJSHandler> weak_ptr_factory_{this};
 };
 
@@ -21,6 +21,10 @@ const maxTimeMSBeforeStart = 2500
 const minAdTextChars = 30
 const minAdTextWords = 5
 
+// Newly seen classes and ids are batched until the thread is idle, but are
+// queried at most this long after they were first seen.
+const maxTimeMSBeforeClassIdQuery = 100
+
 const queriedIds = new Set<string>()
 const queriedClasses = new Set<string>()
 
@@ -101,14 +105,18 @@ const fetchNewClassIdRules = () => {
   }
   // Callback to c++ renderer process
   // @ts-ignore
-  cf_worker.hiddenClassIdSelectors(
-      JSON.stringify({
-        classes: notYetQueriedClasses, ids: notYetQueriedIds
-      }))
+  cf_worker.hiddenClassIdSelectors(notYetQueriedClasses, notYetQueriedIds)
   notYetQueriedClasses = []
   notYetQueriedIds = []
 }
 
+// Mutation observer callbacks fire constantly on pages that keep modifying
+// the DOM, so the classes and ids they find are queried in one batch.
+const fetchNewClassIdRulesOnIdle = idleize(
+  fetchNewClassIdRules,
+  maxTimeMSBeforeClassIdQuery
+)
+
 const handleMutations: MutationCallback = (mutations: MutationRecord[]) => {
   for (const aMutation of mutations) {
     if (aMutation.type === 'attributes') {
@@ -127,7 +135,7 @@ const handleMutations: MutationCallback = (mutations: MutationRecord[]) => {
 
         case 'id':
           const mutatedId = changedElm.id
-          if (queriedIds.has(mutatedId) === false) {
+          if (mutatedId && queriedIds.has(mutatedId) === false) {
             notYetQueriedIds.push(mutatedId)
             queriedIds.add(mutatedId)
           }
@@ -157,7 +165,7 @@ const handleMutations: MutationCallback = (mutations: MutationRecord[]) => {
     }
   }
 
-  fetchNewClassIdRules()
+  fetchNewClassIdRulesOnIdle()
 }
 
 const _parseDomainCache = Object.create(null)
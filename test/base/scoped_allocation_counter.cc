@@ -0,0 +1,185 @@
+/* Copyright (c) 2021 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "brave/test/base/scoped_allocation_counter.h"
+
+#include <atomic>
+
+#include "base/allocator/buildflags.h"
+#include "base/check.h"
+#include "base/threading/platform_thread.h"
+
+#if BUILDFLAG(USE_ALLOCATOR_SHIM)
+#include "base/allocator/allocator_shim.h"
+#endif
+
+namespace {
+
+// The thread whose allocations are counted, or null when no counter is alive.
+// A thread ref is used rather than a thread_local, since the first use of a
+// thread_local may itself allocate from within the shim.
+std::atomic<base::PlatformThreadRef> g_counting_thread;
+std::atomic<uint64_t> g_allocation_count{0};
+
+#if BUILDFLAG(USE_ALLOCATOR_SHIM)
+using base::allocator::AllocatorDispatch;
+
+void CountAllocations(uint64_t count) {
+  if (g_counting_thread.load(std::memory_order_relaxed) ==
+      base::PlatformThread::CurrentRef()) {
+    g_allocation_count.fetch_add(count, std::memory_order_relaxed);
+  }
+}
+
+void* CountingAlloc(const AllocatorDispatch* self,
+                    size_t size,
+                    void* context) {
+  CountAllocations(1);
+  return self->next->alloc_function(self->next, size, context);
+}
+
+void* CountingAllocUnchecked(const AllocatorDispatch* self,
+                             size_t size,
+                             void* context) {
+  CountAllocations(1);
+  return self->next->alloc_unchecked_function(self->next, size, context);
+}
+
+void* CountingAllocZeroInitialized(const AllocatorDispatch* self,
+                                   size_t n,
+                                   size_t size,
+                                   void* context) {
+  CountAllocations(1);
+  return self->next->alloc_zero_initialized_function(self->next, n, size,
+                                                     context);
+}
+
+void* CountingAllocAligned(const AllocatorDispatch* self,
+                           size_t alignment,
+                           size_t size,
+                           void* context) {
+  CountAllocations(1);
+  return self->next->alloc_aligned_function(self->next, alignment, size,
+                                            context);
+}
+
+void* CountingRealloc(const AllocatorDispatch* self,
+                      void* address,
+                      size_t size,
+                      void* context) {
+  CountAllocations(1);
+  return self->next->realloc_function(self->next, address, size, context);
+}
+
+void CountingFree(const AllocatorDispatch* self, void* address, void* context) {
+  self->next->free_function(self->next, address, context);
+}
+
+size_t CountingGetSizeEstimate(const AllocatorDispatch* self,
+                               void* address,
+                               void* context) {
+  return self->next->get_size_estimate_function(self->next, address, context);
+}
+
+unsigned CountingBatchMalloc(const AllocatorDispatch* self,
+                             size_t size,
+                             void** results,
+                             unsigned num_requested,
+                             void* context) {
+  const unsigned count = self->next->batch_malloc_function(
+      self->next, size, results, num_requested, context);
+  CountAllocations(count);
+  return count;
+}
+
+void CountingBatchFree(const AllocatorDispatch* self,
+                       void** to_be_freed,
+                       unsigned num_to_be_freed,
+                       void* context) {
+  self->next->batch_free_function(self->next, to_be_freed, num_to_be_freed,
+                                  context);
+}
+
+void CountingFreeDefiniteSize(const AllocatorDispatch* self,
+                              void* address,
+                              size_t size,
+                              void* context) {
+  self->next->free_definite_size_function(self->next, address, size, context);
+}
+
+void* CountingAlignedMalloc(const AllocatorDispatch* self,
+                            size_t size,
+                            size_t alignment,
+                            void* context) {
+  CountAllocations(1);
+  return self->next->aligned_malloc_function(self->next, size, alignment,
+                                             context);
+}
+
+void* CountingAlignedRealloc(const AllocatorDispatch* self,
+                             void* address,
+                             size_t size,
+                             size_t alignment,
+                             void* context) {
+  CountAllocations(1);
+  return self->next->aligned_realloc_function(self->next, address, size,
+                                              alignment, context);
+}
+
+void CountingAlignedFree(const AllocatorDispatch* self,
+                         void* address,
+                         void* context) {
+  self->next->aligned_free_function(self->next, address, context);
+}
+
+AllocatorDispatch g_counting_dispatch = {
+    &CountingAlloc,          &CountingAllocUnchecked,
+    &CountingAllocZeroInitialized,
+    &CountingAllocAligned,   &CountingRealloc,
+    &CountingFree,           &CountingGetSizeEstimate,
+    &CountingBatchMalloc,    &CountingBatchFree,
+    &CountingFreeDefiniteSize,
+    &CountingAlignedMalloc,  &CountingAlignedRealloc,
+    &CountingAlignedFree,    nullptr};
+
+void InstallAllocationCounter() {
+  // Dispatches cannot be removed, so it stays installed and only counts while
+  // a counter is alive.
+  static bool installed = false;
+  if (installed)
+    return;
+  base::allocator::InsertAllocatorDispatch(&g_counting_dispatch);
+  installed = true;
+}
+#endif  // BUILDFLAG(USE_ALLOCATOR_SHIM)
+
+}  // namespace
+
+// static
+bool ScopedAllocationCounter::IsSupported() {
+#if BUILDFLAG(USE_ALLOCATOR_SHIM)
+  return true;
+#else
+  return false;
+#endif
+}
+
+ScopedAllocationCounter::ScopedAllocationCounter() {
+  DCHECK(g_counting_thread.load().is_null());
+#if BUILDFLAG(USE_ALLOCATOR_SHIM)
+  InstallAllocationCounter();
+#endif
+  g_allocation_count = 0;
+  g_counting_thread = base::PlatformThread::CurrentRef();
+}
+
+ScopedAllocationCounter::~ScopedAllocationCounter() {
+  DCHECK(g_counting_thread.load() == base::PlatformThread::CurrentRef());
+  g_counting_thread = base::PlatformThreadRef();
+}
+
+uint64_t ScopedAllocationCounter::count() const {
+  return g_allocation_count;
+}
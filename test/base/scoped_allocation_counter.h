@@ -0,0 +1,30 @@
+/* Copyright (c) 2021 The Brave Authors. All rights reserved.
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this file,
+ * You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef BRAVE_TEST_BASE_SCOPED_ALLOCATION_COUNTER_H_
+#define BRAVE_TEST_BASE_SCOPED_ALLOCATION_COUNTER_H_
+
+#include <stdint.h>
+
+// Counts the heap allocations made on the thread that created it while it is
+// alive, including those made through malloc by Rust and C libraries.
+// Allocations made meanwhile by other threads, such as the thread pool, are
+// not counted. Counters cannot be nested.
+class ScopedAllocationCounter {
+ public:
+  // Whether allocations can be counted, which needs the allocator shim. When
+  // not, count() is always 0.
+  static bool IsSupported();
+
+  ScopedAllocationCounter();
+  ~ScopedAllocationCounter();
+
+  uint64_t count() const;
+
+  ScopedAllocationCounter(const ScopedAllocationCounter&) = delete;
+  ScopedAllocationCounter& operator=(const ScopedAllocationCounter&) = delete;
+};
+
+#endif  // BRAVE_TEST_BASE_SCOPED_ALLOCATION_COUNTER_H_